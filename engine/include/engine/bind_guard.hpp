@@ -1,27 +1,31 @@
 #pragma once
 
-#include <any>
+#include <engine/bindable.hpp>
 
 namespace dg
 {
 
-struct bindable;
-
+///! statically typed, previous binding is kept by value, so there is no type erasure or virtual call
+template <bindable T>
 struct bind_guard
 {
 public:
-    bind_guard(bindable&);
+    bind_guard(T& o)
+        : obj{ o }
+        , state{ o.bind() }
+    {
+    }
 
     bind_guard(const bind_guard&) = delete;
     bind_guard(bind_guard&&) = delete;
     bind_guard& operator=(const bind_guard&) = delete;
     bind_guard& operator=(bind_guard&&) = delete;
 
-    ~bind_guard();
+    ~bind_guard() { obj.unbind(state); }
 
 private:
-    bindable& obj;
-    std::any data;
+    T& obj;
+    typename T::bind_state_t state;
 };
 
 } // namespace dg
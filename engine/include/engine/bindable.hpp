@@ -1,17 +1,15 @@
 #pragma once
 
-#include <any>
+#include <concepts>
 
 namespace dg
 {
 
-struct bindable
-{
-public:
-    virtual ~bindable() = default;
-
-    virtual std::any bind() = 0;
-    virtual void unbind(std::any) = 0;
+///! `bind` makes object current and returns state which `unbind` needs to restore previous one
+template <class T>
+concept bindable = requires(T& obj, typename T::bind_state_t state) {
+    { obj.bind() } -> std::same_as<typename T::bind_state_t>;
+    obj.unbind(state);
 };
 
 } // namespace dg
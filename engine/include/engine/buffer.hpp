@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+namespace dg
+{
+
+struct context;
+
+struct buffer
+{
+public:
+    struct error : public std::runtime_error
+    {
+        explicit error(std::string const&);
+        error(char const*);
+    };
+
+    enum class target_t
+    {
+        array,
+        element_array,
+        uniform,
+        shader_storage,
+        draw_indirect,
+        pixel_pack
+    };
+
+    buffer(context& ctx, target_t target);
+
+    buffer(buffer const&) = delete;
+    buffer(buffer&&);
+
+    buffer& operator=(buffer);
+    buffer& operator=(buffer const&) = delete;
+    buffer& operator=(buffer&&) = delete;
+
+    ~buffer();
+
+    enum class data_t
+    {
+        immutable,
+        dynamic,
+        stream,
+        ///! written by GPU and read back by CPU, e.g. pixel pack buffers
+        readback
+    };
+
+    ///! (re)allocates storage, `data` may be empty to allocate `size` uninitialized bytes
+    void load(data_t type, std::span<std::byte const> data, std::size_t size = 0);
+    void update(std::size_t offset, std::span<std::byte const> data);
+    ///! copies `out.size()` bytes from `offset` into `out`, waits if GPU still writes the buffer,
+    ///! so fence it first to not stall
+    void read(std::size_t offset, std::span<std::byte> out);
+
+    template <class T>
+    void
+    load(data_t type, std::span<T> data)
+    {
+        load(type, std::as_bytes(data));
+    }
+
+    template <class T>
+    void
+    update(std::size_t offset, std::span<T> data)
+    {
+        update(offset, std::as_bytes(data));
+    }
+
+    template <class T>
+    void
+    read(std::size_t offset, std::span<T> out)
+    {
+        read(offset, std::as_writable_bytes(out));
+    }
+
+    ///! binds to indexed binding point, only for `uniform` and `shader_storage` targets
+    void bind_base(uint32_t index);
+    void bind_base(target_t target, uint32_t index);
+
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] target_t target() const;
+
+    using bind_state_t = uint32_t;
+    bind_state_t bind();
+    void unbind(bind_state_t prev);
+
+private:
+    context* ctx{ nullptr };
+
+    using handle_t = uint32_t;
+    handle_t handle{ 0 };
+    target_t type{ target_t::array };
+    std::size_t bytes{ 0 };
+};
+
+} // namespace dg
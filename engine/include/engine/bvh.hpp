@@ -0,0 +1,120 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace dg
+{
+
+struct frustum;
+struct mesh;
+struct thread_pool;
+
+struct aabb
+{
+    glm::vec3 min{ std::numeric_limits<float>::max() };
+    glm::vec3 max{ std::numeric_limits<float>::lowest() };
+
+    void grow(glm::vec3 const& p);
+    void grow(aabb const& box);
+
+    [[nodiscard]] glm::vec3 center() const;
+    ///! half of surface area, which is enough for SAH
+    [[nodiscard]] float half_area() const;
+    [[nodiscard]] bool overlaps(aabb const& box) const;
+    ///! box of transformed box, it isn't tight for rotations
+    [[nodiscard]] aabb transformed(glm::mat4 const& m) const;
+};
+
+///! `direction` needn't be normalized, distances are in its units
+struct ray
+{
+    glm::vec3 origin{ 0.0f };
+    glm::vec3 direction{ 0.0f, 0.0f, -1.0f };
+};
+
+///! bounding volume hierarchy over boxes, built with binned surface area heuristic.
+///! It only knows primitive bounds, so exact ray tests are done by caller, see `mesh_bvh`
+struct bvh
+{
+public:
+    using primitive_id = uint32_t;
+
+    struct hit
+    {
+        primitive_id primitive{ 0 };
+        float distance{ 0.0f };
+    };
+
+    ///! 32 bytes, children of inner node are adjacent, so one index is enough
+    struct node
+    {
+        glm::vec3 min{ 0.0f };
+        ///! left child for inner node, right one is `first + 1`; first primitive for leaf
+        uint32_t first{ 0 };
+        glm::vec3 max{ 0.0f };
+        ///! 0 for inner nodes
+        uint32_t count{ 0 };
+    };
+    static_assert(sizeof(node) == 32);
+
+    ///! ids of primitives are indices into `bounds`. Leaves are split while SAH says it pays off
+    void build(std::span<aabb const> bounds, uint32_t max_leaf_size = 4);
+    ///! recomputes node bounds after primitives moved, tree stays the same, so it gets worse
+    ///! with large movements and `build` should be called again then
+    void refit(std::span<aabb const> bounds);
+
+    ///! replace `out` with primitives which bounds overlap `box` or intersect `f`
+    void query(aabb const& box, std::vector<primitive_id>& out) const;
+    void query(frustum const& f, std::vector<primitive_id>& out) const;
+
+    ///! returns exact distance to primitive along `r` if it is hit closer than `max_distance`
+    using hit_test = std::function<std::optional<float>(primitive_id id, float max_distance)>;
+    ///! closest hit, `test` is called only for primitives which bounds are hit closer than
+    ///! the closest hit found so far, near nodes are visited first
+    [[nodiscard]] std::optional<hit>
+    raycast(ray const& r, hit_test const& test,
+            float max_distance = std::numeric_limits<float>::max()) const;
+
+    [[nodiscard]] std::span<node const> nodes() const;
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    std::vector<node> tree;
+    ///! primitive ids and their bounds in leaf order, leaves refer to ranges of them
+    std::vector<primitive_id> primitives;
+    std::vector<aabb> boxes;
+};
+
+///! triangle BVH of one mesh, triangles are copied out of index buffer
+struct mesh_bvh
+{
+public:
+    mesh_bvh() = default;
+    explicit mesh_bvh(mesh const& m, uint32_t max_leaf_size = 4);
+
+    ///! builds one tree per mesh on `pool`
+    [[nodiscard]] static std::vector<mesh_bvh> build(thread_pool& pool,
+                                                     std::span<mesh const* const> meshes);
+
+    ///! `primitive` of hit is triangle index, i.e. its first index is `3 * primitive`
+    [[nodiscard]] std::optional<bvh::hit>
+    raycast(ray const& r, float max_distance = std::numeric_limits<float>::max()) const;
+
+    [[nodiscard]] aabb bounds() const;
+
+private:
+    bvh tree;
+    ///! three vertices per triangle
+    std::vector<glm::vec3> triangles;
+    aabb box;
+};
+
+} // namespace dg
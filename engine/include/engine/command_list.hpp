@@ -0,0 +1,39 @@
+#pragma once
+
+#include <engine/render_queue.hpp>
+
+#include <span>
+#include <vector>
+
+namespace dg
+{
+
+///! draws recorded without touching GL, so any thread can fill its own list.
+///! Lists are merged into `render_queue` and replayed on GL thread
+struct command_list
+{
+public:
+    void
+    push(render_queue::draw const& d)
+    {
+        recorded.push_back(d);
+    }
+
+    ///! keeps capacity, so lists reused every frame don't allocate
+    void
+    clear()
+    {
+        recorded.clear();
+    }
+
+    [[nodiscard]] std::span<render_queue::draw const>
+    draws() const
+    {
+        return recorded;
+    }
+
+private:
+    std::vector<render_queue::draw> recorded;
+};
+
+} // namespace dg
@@ -7,10 +7,14 @@
 #include <filesystem>
 #include <memory>
 #include <stdexcept>
+#include <string_view>
 
 namespace dg
 {
 
+struct deletion_queue;
+struct gl_state;
+
 struct context
 {
 public:
@@ -24,10 +28,10 @@ public:
      * @throws `context_error`, `std::bad_alloc`
      */
     context(char const* const window_title, glm::u32vec2 window_size);
-    context(context&&);
+    ///! GL objects keep pointer to context, so it never moves
+    context(context&&) = delete;
     context(const context&) = delete;
 
-    context& operator=(context);
     context& operator=(context&&) = delete;
     context& operator=(context const&) = delete;
 
@@ -44,20 +48,62 @@ public:
     friend buffer operator&(buffer, buffer);
 
     void clear_window(glm::vec4 color = { 0, 0, 0, 1 }, buffer mask = buffer::color | buffer::depth);
+    ///! also ends the frame, see `deletions`
     void swap_window();
     [[nodiscard]] glm::u32vec2 window_size() const;
+    ///! size of default framebuffer in pixels, bigger than `window_size` on high density displays
+    [[nodiscard]] glm::u32vec2 drawable_size() const;
 
     static std::filesystem::path resources_path();
+    ///! per user writable directory for caches, empty if platform doesn't provide one
+    [[nodiscard]] std::filesystem::path const& cache_path() const;
 
     enum class capability
     {
-        depth_test
+        depth_test,
+        blend,
+        cull_face,
+        scissor_test,
+        stencil_test,
+        polygon_offset_fill
     };
     void enable(capability);
+    void disable(capability);
+
+    ///! e.g. "GL_KHR_parallel_shader_compile", list is queried once at creation
+    [[nodiscard]] bool has_extension(std::string_view name) const;
 
     void window_relative_mouse_mode(bool enable);
     void window_mouse_position(glm::vec2 pos);
 
+    ///! GL objects are released through this queue, it is drained at the end of each frame
+    deletion_queue& deletions();
+    gl_state& state();
+
+    struct stats_t
+    {
+        uint64_t state_changes{ 0 };
+        ///! binds skipped because shadow state already matched
+        uint64_t elided_state_changes{ 0 };
+        uint64_t uniform_uploads{ 0 };
+        ///! uploads skipped because program already had the same value
+        uint64_t elided_uniform_uploads{ 0 };
+        uint64_t draw_calls{ 0 };
+        ///! objects skipped because their last occlusion query found them hidden
+        uint64_t occlusion_culled{ 0 };
+        uint64_t occlusion_queries{ 0 };
+        ///! query results read in the frame and frames they took since issue, summed
+        uint64_t occlusion_results{ 0 };
+        uint64_t occlusion_latency_frames{ 0 };
+        ///! shadow map faces reused from static caster cache and rendered again
+        uint64_t shadow_cache_hits{ 0 };
+        uint64_t shadow_cache_misses{ 0 };
+    };
+    ///! counters of the last finished frame
+    [[nodiscard]] stats_t const& stats() const;
+    ///! counters of the current frame, engine modules accumulate into them
+    stats_t& frame_stats();
+
 private:
     static context const* ctx;
 
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace dg
+{
+
+struct gl_state;
+
+///! postpones `glDelete*` of GL objects until GPU has retired the frame which used them,
+///! so destroying objects in the middle of frame doesn't force driver synchronization
+struct deletion_queue
+{
+public:
+    enum class object_t
+    {
+        program,
+        vertex_array,
+        buffer,
+        texture,
+        framebuffer,
+        renderbuffer,
+        query,
+
+        count
+    };
+
+    explicit deletion_queue(gl_state& state);
+
+    deletion_queue(deletion_queue const&) = delete;
+    deletion_queue(deletion_queue&&) = delete;
+
+    deletion_queue& operator=(deletion_queue const&) = delete;
+    deletion_queue& operator=(deletion_queue&&) = delete;
+
+    ///! `flush` must be called before GL context is destroyed
+    ~deletion_queue() = default;
+
+    using handle_t = uint32_t;
+    void push(object_t type, handle_t handle);
+
+    ///! fences objects pushed during the frame and deletes ones whose frames are retired
+    void end_frame();
+    ///! deletes everything immediately
+    void flush();
+
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    using handles_t = std::array<std::vector<handle_t>, static_cast<std::size_t>(object_t::count)>;
+
+    struct batch
+    {
+        // `GLsync`, kept opaque to not leak GL headers
+        void* fence{ nullptr };
+        handles_t handles;
+    };
+
+    void destroy(handles_t& handles);
+
+    gl_state& state;
+
+    handles_t pending;
+    std::deque<batch> in_flight;
+};
+
+} // namespace dg
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <engine/shader_program.hpp>
+
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <string_view>
+
+namespace dg
+{
+
+struct context;
+struct vertex_array;
+
+///! transforms vertex positions at attribute 0 by `model_view_proj` uniform
+constexpr std::string_view depth_only_vertex_shader_src = R"(
+#version 320 es
+
+layout (location = 0) in vec3 position;
+
+uniform mat4 model_view_proj;
+
+void main()
+{
+    gl_Position = model_view_proj * vec4(position, 1.0f);
+}
+)";
+
+///! writes no color, pairs with any vertex shader, e.g. the one of shaded pass for depth pre-pass
+constexpr std::string_view depth_only_fragment_shader_src = R"(
+#version 320 es
+
+void main()
+{
+}
+)";
+
+///! links `depth_only_vertex_shader_src` with `fragment_src`, passes which output a constant per
+///! draw, e.g. picking ids, give their own
+///! @throws `shader_program::error`
+shader_program depth_only_program(context& ctx,
+                                  std::string_view fragment_src = depth_only_fragment_shader_src);
+
+///! range of indexed triangles of a mesh, vertex positions must be at attribute 0
+struct draw_item
+{
+    vertex_array* vao{ nullptr };
+    uint32_t first_index{ 0 };
+    uint32_t index_count{ 0 };
+    glm::mat4 model{ 1.0f };
+
+    ///! binds `vao`, sets `model_view_proj` of `program` made by `depth_only_program` and draws.
+    ///! Program must be already in use, draw calls aren't counted
+    void draw(shader_program& program, glm::mat4 const& view_proj) const;
+
+    bool operator==(draw_item const&) const = default;
+};
+
+} // namespace dg
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+namespace dg
+{
+
+struct context;
+struct texture;
+
+///! render target made of texture attachments, which stay owned by the caller and must outlive
+///! it. Attachments are remembered, so `invalidate` discards all of them
+struct framebuffer
+{
+public:
+    struct error : public std::runtime_error
+    {
+        explicit error(std::string const&);
+        error(char const*);
+    };
+
+    static constexpr uint32_t max_color_attachments{ 4 };
+
+    framebuffer(context& ctx);
+
+    framebuffer(framebuffer const&) = delete;
+    framebuffer(framebuffer&&);
+
+    framebuffer& operator=(framebuffer);
+
+    ~framebuffer();
+
+    ///! attaches `layer` of level 0 of `t`, as depth attachment for depth formats and as color
+    ///! attachment `color_index` otherwise. Replaces what was attached there before
+    void attach(texture& t, uint32_t layer = 0, uint32_t color_index = 0);
+    ///! fragment outputs go to color attachments `[0, count)`, 0 for depth only targets
+    void draw_buffers(uint32_t count);
+    ///! @throws `error` if attachments don't make complete framebuffer, `name` goes to message
+    void validate(std::string_view name);
+    ///! contents of all attachments aren't needed anymore, e.g. before they are fully redrawn,
+    ///! so tiled GPUs don't load them into tile memory
+    void invalidate();
+
+    using bind_state_t = uint32_t;
+    ///! both draw and read framebuffer
+    bind_state_t bind();
+    void unbind(bind_state_t prev);
+
+private:
+    context* ctx{ nullptr };
+
+    using handle_t = uint32_t;
+    handle_t handle{ 0 };
+    ///! bit per color attachment
+    uint32_t color_attachments{ 0 };
+    bool has_depth{ false };
+};
+
+} // namespace dg
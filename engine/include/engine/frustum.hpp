@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dg
+{
+
+struct thread_pool;
+
+///! bounding spheres as structure of arrays for `frustum::cull`. Storage is padded to `lanes`
+///! with spheres outside of any frustum, so kernels always test full registers
+struct sphere_bounds
+{
+public:
+    static constexpr std::size_t lanes{ 8 };
+
+    using sphere_id = uint32_t;
+
+    sphere_id add(glm::vec3 const& center, float radius);
+    void set(sphere_id id, glm::vec3 const& center, float radius);
+    void clear();
+
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    friend struct frustum;
+
+    std::size_t count{ 0 };
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<float> zs;
+    std::vector<float> radii;
+};
+
+struct frustum
+{
+public:
+    enum class plane
+    {
+        left,
+        right,
+        bottom,
+        top,
+        znear,
+        zfar
+    };
+
+    ///! planes are normalized and point inside, i.e. `dot(xyz, p) + w >= 0` for visible `p`
+    std::array<glm::vec4, 6> planes{};
+
+    static frustum from_matrix(glm::mat4 const& view_proj);
+
+    [[nodiscard]] bool intersects_sphere(glm::vec3 const& center, float radius) const;
+    [[nodiscard]] bool intersects_aabb(glm::vec3 const& min, glm::vec3 const& max) const;
+
+    ///! replaces `visible` with ids of spheres intersecting frustum in ascending order, same
+    ///! result as `intersects_sphere` for each of them. Tests several spheres per instruction
+    void cull(sphere_bounds const& bounds, std::vector<uint32_t>& visible) const;
+    ///! same as above, split across `pool`
+    void cull(thread_pool& pool, sphere_bounds const& bounds, std::vector<uint32_t>& visible,
+              std::size_t min_chunk = 4096) const;
+};
+
+} // namespace dg
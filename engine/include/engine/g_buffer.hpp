@@ -0,0 +1,131 @@
+#pragma once
+
+#include <engine/framebuffer.hpp>
+#include <engine/texture.hpp>
+
+#include <glm/vec2.hpp>
+
+#include <cstdint>
+#include <string_view>
+
+namespace dg
+{
+
+struct context;
+struct pipeline_state;
+
+///! render targets of deferred shading: albedo in RGBA8, octahedral normal in two 16 bit
+///! channels and depth, world position is reconstructed from depth. Contents are invalidated
+///! before geometry pass, so tiled GPUs don't load the previous frame. They are still written
+///! back to memory, because lighting samples them as textures; keeping them in tile memory
+///! would need pixel local storage, with these textures as fallback where it is missing
+struct g_buffer
+{
+public:
+    ///! must be inserted into geometry pass fragment shader instead of color output, alpha of
+    ///! albedo is free for material flags
+    static constexpr std::string_view glsl_output_declarations = R"(
+layout (location = 0) out vec4 dg_gbuffer_albedo;
+layout (location = 1) out highp uvec2 dg_gbuffer_normal;
+
+void dg_gbuffer_store(vec4 albedo, highp vec3 normal)
+{
+    highp vec2 p = normal.xy / (abs(normal.x) + abs(normal.y) + abs(normal.z));
+    if (normal.z < 0.0f)
+    {
+        p = (1.0f - abs(p.yx)) * vec2(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    dg_gbuffer_albedo = albedo;
+    dg_gbuffer_normal = uvec2(round(clamp(p * 0.5f + 0.5f, 0.0f, 1.0f) * 65535.0f));
+}
+)";
+
+    ///! must be inserted into lighting fragment shader after default float precision, `pixel`
+    ///! is `ivec2(gl_FragCoord.xy)`. Depth is 1 where nothing was drawn
+    static constexpr std::string_view glsl_input_declarations = R"(
+layout (binding = 8) uniform sampler2D dg_gbuffer_albedo_map;
+layout (binding = 9) uniform highp usampler2D dg_gbuffer_normal_map;
+layout (binding = 10) uniform highp sampler2D dg_gbuffer_depth_map;
+
+vec4 dg_gbuffer_albedo(highp ivec2 pixel)
+{
+    return texelFetch(dg_gbuffer_albedo_map, pixel, 0);
+}
+
+highp vec3 dg_gbuffer_normal(highp ivec2 pixel)
+{
+    highp vec2 p = vec2(texelFetch(dg_gbuffer_normal_map, pixel, 0).xy) / 65535.0f * 2.0f - 1.0f;
+    highp vec3 n = vec3(p, 1.0f - abs(p.x) - abs(p.y));
+    highp float t = max(-n.z, 0.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
+
+highp float dg_gbuffer_depth(highp ivec2 pixel)
+{
+    return texelFetch(dg_gbuffer_depth_map, pixel, 0).r;
+}
+
+highp vec3 dg_gbuffer_position(highp ivec2 pixel, highp mat4 inv_view_proj)
+{
+    highp vec2 uv = (vec2(pixel) + 0.5f) / vec2(textureSize(dg_gbuffer_depth_map, 0));
+    highp vec4 ndc = vec4(uv, dg_gbuffer_depth(pixel), 1.0f) * 2.0f - 1.0f;
+    highp vec4 p = inv_view_proj * ndc;
+    return p.xyz / p.w;
+}
+)";
+
+    ///! full screen triangle without vertex attributes, paired with lighting fragment shader
+    static constexpr std::string_view resolve_vertex_shader_src = R"(
+#version 320 es
+
+void main()
+{
+    vec2 p = vec2(gl_VertexID == 1 ? 3.0f : -1.0f, gl_VertexID == 2 ? 3.0f : -1.0f);
+    gl_Position = vec4(p, 0.0f, 1.0f);
+}
+)";
+
+    static constexpr uint32_t albedo_unit{ 8 };
+    static constexpr uint32_t normal_unit{ 9 };
+    static constexpr uint32_t depth_unit{ 10 };
+
+    /*
+     * @throws `texture::error`, `framebuffer::error`
+     */
+    g_buffer(context& ctx, glm::u32vec2 size);
+
+    g_buffer(g_buffer const&) = delete;
+    g_buffer(g_buffer&&) = delete;
+
+    g_buffer& operator=(g_buffer const&) = delete;
+    g_buffer& operator=(g_buffer&&) = delete;
+
+    ///! reallocates targets if `size` differs, e.g. after window resize
+    void resize(glm::u32vec2 size);
+
+    ///! binds the targets for geometry pass, only depth is cleared, color is left undefined
+    void begin();
+    ///! binds framebuffer which was bound before `begin`
+    void end();
+    ///! draws full screen triangle with `lighting`, which reads the targets, into bound
+    ///! framebuffer
+    void resolve(pipeline_state const& lighting);
+
+    [[nodiscard]] glm::u32vec2 size() const;
+
+private:
+    ///! (re)attaches targets after they are created
+    void attach();
+
+    context& ctx;
+    glm::u32vec2 extent;
+
+    texture albedo_target;
+    texture normal_target;
+    texture depth_target;
+    framebuffer render_target;
+    framebuffer::bind_state_t prev_framebuffer{ 0 };
+};
+
+} // namespace dg
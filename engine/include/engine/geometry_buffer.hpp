@@ -0,0 +1,48 @@
+#pragma once
+
+#include <engine/mesh.hpp>
+#include <engine/vertex_array.hpp>
+
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace dg
+{
+
+struct context;
+
+///! packs many meshes into one vertex_array, so they can be drawn by offset without rebinding
+struct geometry_buffer
+{
+public:
+    geometry_buffer(context& ctx);
+
+    using mesh_id = uint32_t;
+
+    struct range
+    {
+        uint32_t first_index{ 0 };
+        uint32_t index_count{ 0 };
+        ///! local bounding sphere: center in `xyz`, radius in `w`
+        glm::vec4 bounds{ 0 };
+    };
+
+    ///! positions go to location 0, normals to location 1
+    mesh_id add(mesh const& m);
+    ///! must be called once, after all meshes were added
+    void upload(vertex_array::data_t type = vertex_array::data_t::immutable);
+
+    [[nodiscard]] range const& at(mesh_id id) const;
+    [[nodiscard]] std::size_t size() const;
+
+    vertex_array& vao();
+
+private:
+    vertex_array array;
+    std::vector<range> ranges;
+    mesh staging;
+};
+
+} // namespace dg
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <engine/buffer.hpp>
+#include <engine/context.hpp>
+#include <engine/deletion_queue.hpp>
+#include <engine/pipeline_state.hpp>
+#include <engine/texture.hpp>
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace dg
+{
+
+///! CPU side shadow of GL bindings, redundant binds are skipped and driver is never queried.
+///! All GL state changes covered here must go through it, otherwise call `invalidate`
+struct gl_state
+{
+public:
+    using handle_t = uint32_t;
+    ///! binding isn't known, e.g. element array buffer after vertex array change
+    static constexpr handle_t unknown{ ~handle_t{ 0 } };
+
+    static constexpr uint32_t max_texture_units{ 32 };
+    static constexpr uint32_t max_buffer_bindings{ 16 };
+
+    explicit gl_state(context::stats_t& stats);
+
+    gl_state(gl_state const&) = delete;
+    gl_state(gl_state&&) = delete;
+
+    gl_state& operator=(gl_state const&) = delete;
+    gl_state& operator=(gl_state&&) = delete;
+
+    ~gl_state() = default;
+
+    ///! every setter returns previous value, so it can be restored later
+    handle_t use_program(handle_t program);
+    handle_t bind_vertex_array(handle_t vao);
+    handle_t bind_buffer(buffer::target_t target, handle_t buf);
+    ///! only for `uniform` and `shader_storage`, also changes generic binding like GL does
+    void bind_buffer_base(buffer::target_t target, uint32_t index, handle_t buf);
+    handle_t bind_texture(uint32_t unit, texture::target_t target, handle_t tex);
+    ///! both draw and read framebuffer, 0 is window
+    handle_t bind_framebuffer(handle_t fbo);
+    void active_texture(uint32_t unit);
+    bool enable(context::capability cap, bool enable = true);
+    void depth_mask(bool write);
+    void depth_func(pipeline_state::compare_t func);
+    void blend_func(pipeline_state::blend_factor_t src, pipeline_state::blend_factor_t dst);
+    void cull_face(pipeline_state::face_t face);
+
+    [[nodiscard]] handle_t bound_program() const;
+    [[nodiscard]] handle_t bound_vertex_array() const;
+    [[nodiscard]] handle_t bound_buffer(buffer::target_t target) const;
+    [[nodiscard]] handle_t bound_framebuffer() const;
+    [[nodiscard]] handle_t bound_texture(uint32_t unit, texture::target_t target) const;
+    [[nodiscard]] uint32_t active_texture_unit() const;
+    [[nodiscard]] bool is_enabled(context::capability cap) const;
+
+    ///! called when objects are really deleted, GL resets bindings of deleted names
+    void forget(deletion_queue::object_t type, std::span<handle_t const> handles);
+    ///! marks everything as unknown, so next bind of anything is issued
+    void invalidate();
+
+private:
+    bool is_redundant(bool equal);
+
+    context::stats_t& stats;
+
+    handle_t current_program{ 0 };
+    handle_t current_vertex_array{ 0 };
+    handle_t current_framebuffer{ 0 };
+    std::array<handle_t, 6> buffers{};
+    std::array<std::array<handle_t, max_buffer_bindings>, 2> indexed_buffers{};
+    std::array<std::array<handle_t, 3>, max_texture_units> textures{};
+    uint32_t active_unit{ 0 };
+    // unknown state is encoded as separate mask
+    uint32_t capabilities{ 0 };
+    uint32_t unknown_capabilities{ 0 };
+    // fixed function values as underlying enum values, GL defaults initially
+    uint32_t depth_write{ 1 };
+    uint32_t depth_function{ static_cast<uint32_t>(pipeline_state::compare_t::less) };
+    uint32_t blend_src{ static_cast<uint32_t>(pipeline_state::blend_factor_t::one) };
+    uint32_t blend_dst{ static_cast<uint32_t>(pipeline_state::blend_factor_t::zero) };
+    uint32_t culled_face{ static_cast<uint32_t>(pipeline_state::face_t::back) };
+};
+
+} // namespace dg
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <engine/buffer.hpp>
+#include <engine/geometry_buffer.hpp>
+#include <engine/shader_program.hpp>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace dg
+{
+
+struct context;
+
+///! GPU driven drawing: objects are culled by compute shader, which also fills
+///! indirect draw commands, so CPU cost of `cull` + `draw` depends only on number of meshes
+struct gpu_scene
+{
+public:
+    struct error : public std::runtime_error
+    {
+        explicit error(std::string const&);
+        error(char const*);
+    };
+
+    ///! must be inserted into vertex shader used with `draw`, right after `#version`
+    ///! call `dg_instance_model()` to get model matrix of current instance
+    static constexpr std::string_view glsl_declarations = R"(
+struct dg_object
+{
+    mat4 model;
+    vec4 bounds;
+    uvec4 mesh;
+};
+
+layout (std430, binding = 0) readonly buffer dg_objects_block { dg_object dg_objects[]; };
+layout (std430, binding = 2) readonly buffer dg_visible_block { uint dg_visible[]; };
+
+layout (location = 15) uniform uint dg_instance_offset;
+
+mat4 dg_instance_model()
+{
+    return dg_objects[dg_visible[dg_instance_offset + uint(gl_InstanceID)]].model;
+}
+)";
+    static constexpr shader_program::uniform_location instance_offset_location{ 15 };
+
+    /*
+     * @throws `gpu_scene::error`, `shader_program::error`, `buffer::error`
+     */
+    gpu_scene(context& ctx, geometry_buffer& geometry);
+
+    using object_id = uint32_t;
+
+    ///! `geometry` must be uploaded and must not change after first object was added
+    object_id add(geometry_buffer::mesh_id mesh, glm::mat4 const& model);
+    void transform(object_id id, glm::mat4 const& model);
+
+    ///! uploads changed objects and runs culling on GPU, results are used by next `draw`
+    void cull(glm::mat4 const& view_proj);
+    void draw(shader_program& program);
+
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    // std430 layout, must match `dg_object`
+    struct object
+    {
+        glm::mat4 model{ 1 };
+        glm::vec4 bounds{ 0 };
+        glm::u32vec4 mesh{ 0 };
+    };
+    static_assert(sizeof(object) == 96);
+
+    // layout is fixed by `glDrawElementsIndirect`
+    struct draw_command
+    {
+        uint32_t count{ 0 };
+        uint32_t instance_count{ 0 };
+        uint32_t first_index{ 0 };
+        int32_t base_vertex{ 0 };
+        uint32_t reserved{ 0 };
+    };
+    static_assert(sizeof(draw_command) == 20);
+
+    void rebuild_layout();
+
+    geometry_buffer& geometry;
+    shader_program culling_program;
+
+    buffer objects_buffer;
+    buffer commands_buffer;
+    buffer visible_buffer;
+    buffer offsets_buffer;
+
+    std::vector<object> objects;
+    std::vector<draw_command> commands;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> counts;
+
+    bool is_layout_dirty{ false };
+    std::size_t dirty_begin{ 0 };
+    std::size_t dirty_end{ 0 };
+};
+
+} // namespace dg
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace dg
+{
+
+///! 64-bit FNV-1a, usable at compile time, pass previous result as `h` to hash several pieces
+constexpr uint64_t fnv1a_offset{ 0xcbf29ce484222325ull };
+
+constexpr uint64_t
+fnv1a(std::string_view str, uint64_t h = fnv1a_offset)
+{
+    for (char const c : str)
+    {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ull;
+    }
+
+    return h;
+}
+
+inline uint64_t
+fnv1a(std::span<std::byte const> bytes, uint64_t h = fnv1a_offset)
+{
+    for (std::byte const b : bytes)
+    {
+        h ^= static_cast<uint8_t>(b);
+        h *= 0x100000001b3ull;
+    }
+
+    return h;
+}
+
+///! name hashed at compile time, so string literal can be passed where it is expected
+///! without any string handling at runtime
+struct hashed_name
+{
+    consteval hashed_name(char const* str)
+        : value{ fnv1a(str) }
+    {
+    }
+
+    constexpr explicit hashed_name(uint64_t hash)
+        : value{ hash }
+    {
+    }
+
+    uint64_t value{ 0 };
+};
+
+static_assert(fnv1a("") == fnv1a_offset);
+static_assert(fnv1a("a") == 0xaf63dc4c8601ec8cull);
+
+} // namespace dg
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <engine/buffer.hpp>
+#include <engine/bvh.hpp>
+#include <engine/uniform_block.hpp>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace dg
+{
+
+struct context;
+struct thread_pool;
+
+///! std430 layout, must match `dg_point_light`
+struct point_light
+{
+    glm::vec3 position{ 0.0f };
+    ///! light has no effect beyond it
+    float radius{ 1.0f };
+    glm::vec3 color{ 1.0f };
+    float intensity{ 1.0f };
+};
+static_assert(sizeof(point_light) == 32);
+
+///! view space froxel grid: screen is split into tiles and view depth into exponential slices.
+///! Point lights are binned into froxels they touch on CPU, slices are binned in parallel and
+///! each froxel tests candidate lights of its slice a SIMD register at a time. Doesn't touch GL
+struct cluster_grid
+{
+public:
+    ///! tiles from bottom left, slices from near plane
+    static constexpr uint32_t tiles_x{ 16 };
+    static constexpr uint32_t tiles_y{ 9 };
+    static constexpr uint32_t slices{ 24 };
+    static constexpr uint32_t count{ tiles_x * tiles_y * slices };
+
+    [[nodiscard]] static constexpr uint32_t
+    index(uint32_t x, uint32_t y, uint32_t z)
+    {
+        return (z * tiles_y + y) * tiles_x + x;
+    }
+
+    ///! rebuilds froxel bounds if `projection` changed, must be OpenGL perspective projection
+    void update(glm::mat4 const& projection);
+    ///! `lights` are in world space, indices into them are stored per froxel
+    void bin(thread_pool& pool, glm::mat4 const& view, std::span<point_light const> lights);
+
+    ///! offset into `light_indices` and count, per froxel
+    [[nodiscard]] std::span<glm::u32vec2 const> clusters() const;
+    [[nodiscard]] std::span<uint32_t const> light_indices() const;
+    ///! view space bounds of froxel
+    [[nodiscard]] aabb const& bounds(uint32_t cluster) const;
+
+    [[nodiscard]] float near_plane() const;
+    [[nodiscard]] float far_plane() const;
+    ///! slice of view depth `d` is `floor(log(d) * scale + bias)`
+    [[nodiscard]] glm::vec2 slice_scale_bias() const;
+
+private:
+    ///! lights overlapping depth range of a slice, padded to whole SIMD registers
+    struct slice
+    {
+        std::vector<float> xs;
+        std::vector<float> ys;
+        std::vector<float> zs;
+        std::vector<float> radii;
+        std::vector<uint32_t> ids;
+        ///! light ids of the slice froxels, offsets in `ranges` are relative to it
+        std::vector<uint32_t> indices;
+    };
+
+    [[nodiscard]] float slice_depth(uint32_t z) const;
+    void bin_slice(uint32_t z);
+
+    glm::mat4 projection{ 0.0f };
+    float z_near{ 0.1f };
+    float z_far{ 100.0f };
+    std::vector<aabb> boxes;
+
+    ///! view space position and radius
+    std::vector<glm::vec4> view_lights;
+    std::vector<slice> slice_lights;
+    std::vector<glm::u32vec2> ranges;
+    std::vector<uint32_t> indices;
+};
+
+///! clustered forward shading: `cluster_grid` is built each frame and uploaded to shader storage
+///! buffers, so fragments shade only lights of their froxel and cost depends on lights per pixel
+struct light_clusters
+{
+public:
+    struct error : public std::runtime_error
+    {
+        explicit error(std::string const&);
+        error(char const*);
+    };
+
+    ///! must be inserted into fragment shader, right after `#version`. `dg_cluster_lights`
+    ///! gives offset and count of `dg_light_indices` for the fragment, `view_depth` is positive
+    static constexpr std::string_view glsl_declarations = R"(
+struct dg_point_light
+{
+    highp vec3 position;
+    highp float radius;
+    vec3 color;
+    float intensity;
+};
+
+layout (std430, binding = 3) readonly buffer dg_lights_block { dg_point_light dg_lights[]; };
+layout (std430, binding = 4) readonly buffer dg_clusters_block { highp uvec2 dg_clusters[]; };
+layout (std430, binding = 5) readonly buffer dg_light_indices_block
+{
+    highp uint dg_light_indices[];
+};
+
+layout (std140, binding = 1) uniform dg_cluster_params
+{
+    highp uvec4 dg_cluster_size;
+    highp vec2 dg_cluster_viewport;
+    highp vec2 dg_cluster_slice_scale_bias;
+};
+
+highp uvec2 dg_cluster_lights(highp vec2 frag_coord, highp float view_depth)
+{
+    highp uvec3 c = uvec3(clamp(frag_coord / dg_cluster_viewport, 0.0f, 0.9999f)
+                          * vec2(dg_cluster_size.xy), 0u);
+    highp float slice = log(max(view_depth, 1e-4f)) * dg_cluster_slice_scale_bias.x
+                        + dg_cluster_slice_scale_bias.y;
+    c.z = uint(clamp(slice, 0.0f, float(dg_cluster_size.z - 1u)));
+    return dg_clusters[(c.z * dg_cluster_size.y + c.y) * dg_cluster_size.x + c.x];
+}
+)";
+    static constexpr uint32_t params_binding{ 1 };
+    static constexpr uint32_t lights_binding{ 3 };
+    static constexpr uint32_t clusters_binding{ 4 };
+    static constexpr uint32_t light_indices_binding{ 5 };
+
+    /*
+     * @throws `light_clusters::error` if fragment shaders can't use three storage buffers, GLES
+     * guarantees none, so callers should shade without `glsl_declarations` then
+     * @throws `buffer::error`
+     */
+    explicit light_clusters(context& ctx);
+
+    ///! bins `lights` on `pool` and uploads them with froxel lists, `viewport` is in pixels
+    void update(thread_pool& pool, glm::mat4 const& projection, glm::mat4 const& view,
+                glm::u32vec2 viewport, std::span<point_light const> lights);
+
+    [[nodiscard]] cluster_grid const& grid() const;
+
+    ///! std140 layout, must match `dg_cluster_params`
+    struct params
+    {
+        glm::u32vec4 size{ 0 };
+        glm::vec2 viewport{ 0.0f };
+        glm::vec2 slice_scale_bias{ 0.0f };
+    };
+
+private:
+    cluster_grid clusters;
+    uniform_block<params> params_block;
+    buffer lights_buffer;
+    buffer clusters_buffer;
+    buffer light_indices_buffer;
+};
+
+} // namespace dg
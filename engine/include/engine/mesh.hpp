@@ -15,6 +15,8 @@ public:
     std::vector<coord_type> vertices;
     std::vector<index_type> indices;
     std::vector<coord_type> normals;
+    ///! two components per vertex, empty if mesh isn't textured
+    std::vector<coord_type> texcoords;
 };
 
 } // namespace dg
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <engine/buffer.hpp>
+#include <engine/depth_only.hpp>
+#include <engine/framebuffer.hpp>
+#include <engine/pipeline_state.hpp>
+#include <engine/shader_program.hpp>
+#include <engine/texture.hpp>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace dg
+{
+
+struct context;
+
+///! GPU picking: ids of objects are rendered into 1x1 integer target, projection is narrowed so
+///! it covers only the pixel under cursor. The pixel is read back through pixel buffer object
+///! and fence, so result is ready a frame or more later and GPU is never waited for.
+///! Rasterization gives exact answer for any mesh, cost depends only on number of draws
+struct object_picker
+{
+public:
+    static constexpr uint32_t no_object{ ~uint32_t{ 0 } };
+
+    struct item
+    {
+        draw_item mesh;
+        uint32_t id{ no_object };
+    };
+
+    /*
+     * @throws `shader_program::error`, `buffer::error`, `texture::error`, `framebuffer::error`
+     */
+    explicit object_picker(context& ctx);
+
+    object_picker(object_picker const&) = delete;
+    object_picker(object_picker&&) = delete;
+
+    object_picker& operator=(object_picker const&) = delete;
+    object_picker& operator=(object_picker&&) = delete;
+
+    ~object_picker();
+
+    ///! renders `items` and starts readback, `cursor` is in window coordinates from top left,
+    ///! as reported by mouse events. Viewport is restored afterwards. If all readbacks are still
+    ///! in flight, the oldest one is dropped
+    void pick(glm::mat4 const& view_proj, glm::vec2 cursor, std::span<item const> items);
+
+    ///! id under cursor of the latest finished pick or `no_object` for background.
+    ///! Nothing when no pick has finished since last call, never waits
+    [[nodiscard]] std::optional<uint32_t> poll();
+
+private:
+    struct readback
+    {
+        buffer pixels;
+        // `GLsync`, kept opaque to not leak GL headers
+        void* fence{ nullptr };
+        uint64_t serial{ 0 };
+    };
+
+    context& ctx;
+    shader_program program;
+    pipeline_state pipeline;
+
+    texture id_target;
+    texture depth_target;
+    framebuffer render_target;
+
+    std::array<readback, 3> readbacks;
+    uint64_t next_serial{ 1 };
+};
+
+} // namespace dg
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <engine/bvh.hpp>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace dg
+{
+
+struct thread_pool;
+
+///! CPU occlusion culling: a few occluder meshes are rasterized into low resolution depth
+///! buffer, max depth hierarchy is built from it and object bounds are tested against it.
+///! Doesn't touch GL, so hidden objects are rejected before any draw call and it runs headless.
+///! Depth is NDC z mapped to `[0, 1]`, rows go from the bottom like in GL
+struct occlusion_culler
+{
+public:
+    ///! rows rasterized by one job, triangles are set up once and binned by rows
+    static constexpr uint32_t tile_height{ 16 };
+
+    ///! width is rounded up to 4, so rows are processed by whole SIMD registers
+    explicit occlusion_culler(glm::u32vec2 resolution = { 256, 128 });
+
+    ///! clears depth and occluders, all later calls use `view_proj`
+    void begin(glm::mat4 const& view_proj);
+    ///! `vertices` are xyz positions. Triangles crossing near plane are skipped, which only
+    ///! makes occluder smaller, so result stays conservative
+    void add_occluder(glm::mat4 const& model, std::span<float const> vertices,
+                      std::span<uint32_t const> indices);
+    ///! rasterizes occluders and builds depth hierarchy
+    void rasterize();
+    ///! same as above, tiles are rasterized on `pool`
+    void rasterize(thread_pool& pool);
+
+    ///! false only if `box` is certainly behind occluders, boxes crossing near plane or
+    ///! outside of screen are visible, frustum culling isn't done here
+    [[nodiscard]] bool is_visible(aabb const& box) const;
+    ///! keeps in `ids` only visible ones of `boxes[id]`, order is kept
+    void cull(thread_pool& pool, std::span<aabb const> boxes, std::vector<uint32_t>& ids) const;
+
+    [[nodiscard]] uint32_t levels() const;
+    [[nodiscard]] glm::u32vec2 size(uint32_t level = 0) const;
+    ///! farthest depth of covered pixels, row by row
+    [[nodiscard]] std::span<float const> depth(uint32_t level = 0) const;
+
+private:
+    ///! screen space edge functions `a * x + b * y + c >= 0` inside and depth plane
+    struct triangle
+    {
+        glm::vec3 edges[3];
+        glm::vec3 depth;
+        glm::ivec2 min;
+        glm::ivec2 max;
+    };
+
+    void rasterize_tile(uint32_t tile);
+    void build_hierarchy();
+
+    glm::mat4 view_proj{ 1.0f };
+    std::vector<triangle> triangles;
+    std::vector<glm::u32vec2> sizes;
+    std::vector<std::vector<float>> hierarchy;
+};
+
+} // namespace dg
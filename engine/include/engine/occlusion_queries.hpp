@@ -0,0 +1,80 @@
+#pragma once
+
+#include <engine/bvh.hpp>
+#include <engine/pipeline_state.hpp>
+#include <engine/shader_program.hpp>
+#include <engine/vertex_array.hpp>
+
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace dg
+{
+
+struct context;
+
+///! GPU occlusion culling: bounding boxes are drawn into current depth buffer inside
+///! `GL_ANY_SAMPLES_PASSED_CONSERVATIVE` queries and results are read a frame or more later, only
+///! when already available. Until then, and for objects not queried recently, the last known
+///! result is used and objects are optimistically drawn. GLES has no conditional rendering, so
+///! culling happens on CPU from these results. Counters go to `context::frame_stats`
+struct occlusion_queries
+{
+public:
+    ///! results older than this are ignored, e.g. object was outside of frustum for a while
+    static constexpr uint64_t max_result_age{ 8 };
+
+    /*
+     * @throws `shader_program::error`
+     */
+    explicit occlusion_queries(context& ctx);
+
+    occlusion_queries(occlusion_queries const&) = delete;
+    occlusion_queries(occlusion_queries&&) = delete;
+
+    occlusion_queries& operator=(occlusion_queries const&) = delete;
+    occlusion_queries& operator=(occlusion_queries&&) = delete;
+
+    ~occlusion_queries();
+
+    ///! starts a frame and collects finished results, never waits
+    void poll();
+    ///! keeps in `ids` only objects which aren't known to be occluded, order is kept
+    void cull(std::vector<uint32_t>& ids);
+    ///! draws boxes of `ids` without color and depth writes, call after scene is drawn so its
+    ///! depth is in the framebuffer. Objects still waiting for result aren't queried again
+    void issue(glm::mat4 const& view_proj, std::span<aabb const> boxes,
+               std::span<uint32_t const> ids);
+
+private:
+    using handle_t = uint32_t;
+
+    struct object
+    {
+        ///! pending query, 0 if none
+        handle_t query{ 0 };
+        uint64_t issued_frame{ 0 };
+        ///! frame the current result was issued in
+        uint64_t result_frame{ 0 };
+        bool is_visible{ true };
+    };
+
+    handle_t acquire();
+
+    context& ctx;
+    shader_program program;
+    pipeline_state pipeline;
+    vertex_array box;
+
+    std::vector<object> objects;
+    ///! ids of objects with pending query
+    std::vector<uint32_t> pending;
+    ///! finished query names, reused instead of generated each frame
+    std::vector<handle_t> free_queries;
+    uint64_t frame{ 0 };
+};
+
+} // namespace dg
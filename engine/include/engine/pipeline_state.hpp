@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+
+namespace dg
+{
+
+struct context;
+struct shader_program;
+struct vertex_array;
+
+///! fixed set of render state, created once and applied as a whole. Applying goes through
+///! `gl_state`, so only the parts which differ from what is currently set reach GL
+struct pipeline_state
+{
+public:
+    enum class compare_t : uint32_t
+    {
+        never,
+        less,
+        equal,
+        less_equal,
+        greater,
+        not_equal,
+        greater_equal,
+        always
+    };
+
+    enum class blend_factor_t : uint32_t
+    {
+        zero,
+        one,
+        src_alpha,
+        one_minus_src_alpha,
+        dst_alpha,
+        one_minus_dst_alpha
+    };
+
+    enum class face_t : uint32_t
+    {
+        front,
+        back,
+        front_and_back
+    };
+
+    struct depth_t
+    {
+        bool test{ true };
+        bool write{ true };
+        compare_t func{ compare_t::less };
+    };
+
+    struct blend_t
+    {
+        bool enable{ false };
+        blend_factor_t src{ blend_factor_t::one };
+        blend_factor_t dst{ blend_factor_t::zero };
+    };
+
+    struct cull_t
+    {
+        bool enable{ false };
+        face_t face{ face_t::back };
+    };
+
+    struct desc
+    {
+        shader_program* program{ nullptr };
+        ///! `nullptr` leaves vertex array to draw calls, e.g. when every mesh has its own one
+        vertex_array* vertex_layout{ nullptr };
+        depth_t depth;
+        blend_t blend;
+        cull_t cull;
+    };
+
+    pipeline_state(context& ctx, desc const& d);
+
+    pipeline_state(pipeline_state const&) = default;
+    pipeline_state(pipeline_state&&) = default;
+
+    pipeline_state& operator=(pipeline_state const&) = delete;
+    pipeline_state& operator=(pipeline_state&&) = delete;
+
+    ~pipeline_state() = default;
+
+    void apply() const;
+
+    [[nodiscard]] desc const& description() const;
+    ///! equal states have equal hashes, used to sort and dedupe draws
+    [[nodiscard]] uint64_t hash() const;
+
+    friend bool operator==(pipeline_state const& l, pipeline_state const& r);
+
+private:
+    context* const ctx;
+    desc const state;
+    uint64_t const key;
+};
+
+} // namespace dg
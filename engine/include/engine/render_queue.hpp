@@ -0,0 +1,127 @@
+#pragma once
+
+#include <engine/hash.hpp>
+
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace dg
+{
+
+struct command_list;
+struct context;
+struct pipeline_state;
+struct thread_pool;
+struct vertex_array;
+
+///! collects draws for a frame, sorts them by key and submits them so that state changes
+///! happen only when the key prefix changes, whatever order draws were added in
+struct render_queue
+{
+public:
+    ///! fields from the most significant bits: pass, pipeline, material, mesh, depth
+    struct sort_key
+    {
+        ///! 4 bits, e.g. opaque before transparent
+        uint32_t pass{ 0 };
+        ///! 12 bits, e.g. low bits of `pipeline_state::hash`
+        uint32_t pipeline{ 0 };
+        ///! 12 bits
+        uint32_t material{ 0 };
+        ///! 12 bits
+        uint32_t mesh{ 0 };
+        ///! 24 bits, see `quantize_depth`
+        uint32_t depth{ 0 };
+
+        [[nodiscard]] constexpr uint64_t
+        pack() const
+        {
+            return uint64_t{ pass & 0xFu } << 60 | uint64_t{ pipeline & 0xFFFu } << 48
+                   | uint64_t{ material & 0xFFFu } << 36 | uint64_t{ mesh & 0xFFFu } << 24
+                   | uint64_t{ depth & 0xFF'FFFFu };
+        }
+    };
+
+    ///! maps view space distance in `[0, max_distance]` to 24 bits, near first.
+    ///! Pass `max_distance - distance` to get back to front order for transparent draws
+    [[nodiscard]] static uint32_t quantize_depth(float distance, float max_distance);
+
+    ///! per object data, uniforms are set by names from `object_uniforms`
+    struct draw
+    {
+        uint64_t key{ 0 };
+        pipeline_state const* pipeline{ nullptr };
+        vertex_array* vao{ nullptr };
+        uint32_t first_index{ 0 };
+        uint32_t index_count{ 0 };
+        glm::mat4 model{ 1.0f };
+        glm::mat3 normal_mat{ 1.0f };
+        glm::vec4 color{ 1.0f };
+    };
+
+    struct object_uniforms
+    {
+        hashed_name model{ "model" };
+        hashed_name normal_mat{ "normal_mat" };
+        hashed_name color{ "vertex_color" };
+    };
+
+    ///! uses default `object_uniforms`
+    explicit render_queue(context& ctx);
+    render_queue(context& ctx, object_uniforms names);
+
+    render_queue(render_queue const&) = delete;
+    render_queue(render_queue&&) = delete;
+
+    render_queue& operator=(render_queue const&) = delete;
+    render_queue& operator=(render_queue&&) = delete;
+
+    ~render_queue();
+
+    void push(draw const& d);
+    void push(command_list const& list);
+
+    ///! runs `fn` over `[0, count)` on `pool`, every chunk records into its own list, which are
+    ///! merged afterwards. `fn` mustn't touch GL, it runs on worker threads
+    void record(thread_pool& pool, std::size_t count,
+                std::function<void(command_list& list, std::size_t begin, std::size_t end)> const& fn,
+                std::size_t min_chunk = 64);
+    ///! sorts and issues all pushed draws, then clears the queue
+    void submit();
+    ///! when set, `submit` first draws all draws of `pass` with `pipeline` sorted only front to
+    ///! back, e.g. with depth only program. Their own pipelines should then test depth for
+    ///! equality without writing it, so expensive shading runs once per pixel. Only model
+    ///! matrix is set for the pre-pass, `nullptr` turns it off
+    void depth_prepass(pipeline_state const* pipeline, uint32_t pass = 0);
+
+    [[nodiscard]] std::size_t size() const;
+
+    ///! stable LSD radix sort, `order` gets indices of `keys` in ascending key order.
+    ///! Bytes equal in all keys are skipped, so only differing fields cost a pass
+    static void radix_sort(std::span<uint64_t const> keys, std::vector<uint32_t>& order);
+
+private:
+    void submit_depth_prepass();
+
+    context& ctx;
+    object_uniforms names;
+    std::vector<draw> draws;
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> order;
+    pipeline_state const* prepass_pipeline{ nullptr };
+    uint32_t prepass_pass{ 0 };
+    // indices of pre-pass draws and their depth fields
+    std::vector<uint32_t> prepass_draws;
+    std::vector<uint64_t> prepass_keys;
+    // one per chunk of `record`, reused between frames
+    std::vector<command_list> lists;
+};
+
+} // namespace dg
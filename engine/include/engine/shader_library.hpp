@@ -0,0 +1,104 @@
+#pragma once
+
+#include <engine/shader_program.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dg
+{
+
+struct context;
+
+///! builds shader variants from base sources and a set of `#define`s, compiles each variant once
+///! and spreads compilation over frames, see `pump`
+struct shader_library
+{
+public:
+    explicit shader_library(context& ctx);
+
+    shader_library(shader_library const&) = delete;
+    shader_library(shader_library&&) = delete;
+
+    shader_library& operator=(shader_library const&) = delete;
+    shader_library& operator=(shader_library&&) = delete;
+
+    ~shader_library() = default;
+
+    struct feature
+    {
+        ///! emitted as `#define name value`, so shaders test it with `#if`
+        std::string name;
+        ///! width of the value in variant key, 1 for on/off features
+        uint32_t bits{ 1 };
+    };
+
+    using base_id = uint32_t;
+    ///! packed feature values, see `key`
+    using variant_key = uint64_t;
+
+    ///! `#define`s are inserted right after `#version` line, total width of features is 64 bits
+    base_id add(std::string_view vertex_src, std::string_view fragment_src,
+                std::vector<feature> features);
+
+    ///! packs feature `values` in order of declaration, compute it once and reuse at draw time
+    [[nodiscard]] variant_key key(base_id base, std::initializer_list<uint32_t> values) const;
+
+    ///! queues variant for compilation, so it is ready by the time it is needed
+    void precompile(base_id base, variant_key key);
+
+    ///! `nullptr` until variant is linked, unknown variants are queued ahead of precompiled ones
+    [[nodiscard]] shader_program* get(base_id base, variant_key key);
+    [[nodiscard]] bool is_failed(base_id base, variant_key key) const;
+
+    ///! must be called once per frame from GL thread, submits at most `max_submits` queued
+    ///! variants and collects finished ones without blocking if driver compiles in parallel.
+    ///! Driver log of failed variant is logged with `SDL_LogError`, see also `is_failed`
+    void pump(uint32_t max_submits);
+
+    [[nodiscard]] std::size_t pending() const;
+
+private:
+    struct variant
+    {
+        explicit variant(context& ctx)
+            : program{ ctx }
+        {
+        }
+
+        shader_program program;
+        shader_program::status_t status{ shader_program::status_t::unlinked };
+        bool is_queued{ false };
+    };
+
+    struct base
+    {
+        std::string vertex_src;
+        std::string fragment_src;
+        std::vector<feature> features;
+        // node based, so variants never move
+        std::unordered_map<variant_key, variant> variants;
+    };
+
+    struct queued
+    {
+        base_id base{ 0 };
+        variant_key key{ 0 };
+    };
+
+    variant& find_or_create(base_id base, variant_key key);
+    void submit(queued q);
+    [[nodiscard]] std::string defines(base_id base, variant_key key) const;
+
+    context& ctx;
+    std::vector<base> bases;
+    std::deque<queued> queue;
+    std::vector<queued> in_flight;
+};
+
+} // namespace dg
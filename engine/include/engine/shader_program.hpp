@@ -1,19 +1,26 @@
 #pragma once
 
-#include <engine/bindable.hpp>
+#include <engine/hash.hpp>
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 
+#include <cstddef>
 #include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace dg
 {
 
 struct context;
 
-struct shader_program : public bindable
+struct shader_program
 {
 public:
     struct error : public std::runtime_error
@@ -22,7 +29,7 @@ public:
         error(char const*);
     };
 
-    shader_program(context const& ctx);
+    shader_program(context& ctx);
 
     shader_program(shader_program const&) = delete;
     shader_program(shader_program&&);
@@ -31,30 +38,142 @@ public:
     shader_program& operator=(shader_program const&) = delete;
     shader_program& operator=(shader_program&&) = delete;
 
-    ~shader_program() override;
+    ~shader_program();
 
     enum class shader_t
     {
         vertex,
-        fragment
+        fragment,
+        compute
     };
 
-    void attach_from_src(shader_t type, std::string_view src);
-    bool link();
-
-    std::any bind() override;
-    void unbind(std::any data) override;
+    enum class status_t
+    {
+        unlinked,
+        ///! compile and link were submitted, driver may still be working on them
+        pending,
+        linked,
+        failed
+    };
 
+    ///! sources are compiled by `link`, only if there is no cached binary for them
+    void attach_from_src(shader_t type, std::string_view src);
+    ///! loads program binary cached by previous run from `context::cache_path`, falls back to
+    ///! compiling attached sources and caches the result. Also reflects active uniforms,
+    ///! attributes and uniform blocks, see `find_uniform`. Blocks until driver finishes
+    ///! @throws `error` with driver log if compilation or linking fails
+    void link();
+    ///! same as `link`, but only submits work to driver, so many programs are compiled in parallel
+    ///! with `KHR_parallel_shader_compile`. Completion is checked with `poll` or `wait`
+    void link_async();
+    ///! doesn't block if `KHR_parallel_shader_compile` is supported, otherwise it is `wait`.
+    ///! Program mustn't be used until it returns `linked`
+    ///! @throws `error` with driver log if compilation or linking fails
+    status_t poll();
+    ///! @throws `error` with driver log if compilation or linking fails
+    status_t wait();
+
+    ///! only for programs with attached `compute` shader
+    void dispatch(glm::u32vec3 groups);
+
+    using bind_state_t = uint32_t;
+    bind_state_t bind();
+    void unbind(bind_state_t prev);
+
+    ///! values are cached per location, unchanged ones aren't uploaded again.
+    ///! Uploads don't bind program, so they can be issued in any order
     using uniform_location = uint32_t;
     void uniform(uniform_location id, glm::vec3 const& vec);
     void uniform(uniform_location id, glm::vec4 const& vec);
     void uniform(uniform_location id, glm::mat3 const& mat);
     void uniform(uniform_location id, glm::mat4 const& mat);
     void uniform(uniform_location id, float v);
+    void uniform(uniform_location id, uint32_t v);
+    ///! also used for samplers, `v` is texture unit
+    void uniform(uniform_location id, int32_t v);
+
+    ///! e.g. `program.uniform("model", m)`, name is hashed at compile time.
+    ///! Like GL does for -1 location, inactive names are ignored
+    template <class T>
+    void
+    uniform(hashed_name name, T const& v)
+    {
+        if (auto const id = find_uniform(name)) uniform(*id, v);
+    }
+
+    ///! lookups in tables reflected by `link`, arrays are found by name without `[0]`
+    [[nodiscard]] std::optional<uniform_location> find_uniform(hashed_name name) const;
+    [[nodiscard]] std::optional<uint32_t> find_attribute(hashed_name name) const;
+    ///! returns binding point of uniform block
+    [[nodiscard]] std::optional<uint32_t> find_uniform_block(hashed_name name) const;
 
 private:
+    context* ctx{ nullptr };
+
     using handle_t = uint64_t;
     handle_t handle{ 0 };
+
+    struct binary_header
+    {
+        uint32_t magic{ 0x42504744 }; // "DGPB"
+        uint32_t format{ 0 };
+    };
+
+    ///! only submits source to driver, status is checked in `finish`
+    [[nodiscard]] uint32_t compile(shader_t type, std::string_view src);
+    void finish();
+    ///! empty if binaries can't be cached, key covers sources and driver
+    [[nodiscard]] std::filesystem::path binary_path() const;
+    bool load_binary(std::filesystem::path const& filename);
+    void save_binary(std::filesystem::path const& filename);
+
+    std::vector<std::pair<shader_t, std::string>> sources;
+    // alive until link is finished to get compile logs
+    std::vector<uint32_t> shaders;
+    std::filesystem::path binary_file;
+    status_t status{ status_t::unlinked };
+
+    struct cached_uniform
+    {
+        ///! 0 if location isn't active, then nothing is cached
+        uint32_t size{ 0 };
+        uint32_t offset{ 0 };
+        bool is_set{ false };
+    };
+
+    struct reflected
+    {
+        uint64_t hash{ 0 };
+        ///! location for uniforms and attributes, binding for blocks
+        uint32_t value{ 0 };
+    };
+    using reflection_table = std::vector<reflected>;
+
+    [[nodiscard]] static std::optional<uint32_t> find(reflection_table const& table,
+                                                      hashed_name name);
+
+    void reflect();
+    void reflect_uniforms();
+    void reflect_attributes();
+    void reflect_uniform_blocks();
+    ///! compares `value` with cache and updates it, true if upload can be skipped
+    bool is_cached(uniform_location id, std::span<std::byte const> value);
+
+    template <class T>
+    bool
+    is_cached(uniform_location id, T const& value)
+    {
+        return is_cached(id, std::as_bytes(std::span<T const>{ &value, 1 }));
+    }
+
+    // indexed by location
+    std::vector<cached_uniform> uniforms;
+    std::vector<std::byte> uniform_values;
+
+    // sorted by hash
+    reflection_table uniform_names;
+    reflection_table attribute_names;
+    reflection_table uniform_block_names;
 };
 
 } // namespace dg
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <engine/bvh.hpp>
+#include <engine/depth_only.hpp>
+#include <engine/framebuffer.hpp>
+#include <engine/pipeline_state.hpp>
+#include <engine/shader_program.hpp>
+#include <engine/texture.hpp>
+#include <engine/uniform_block.hpp>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace dg
+{
+
+struct context;
+
+///! omnidirectional shadow of a point light in depth cube map. Static casters are rendered into
+///! a cached map, a face of it is rendered again only when the light moves or a static caster
+///! changes inside the face frustum. A face of the cache is copied on GPU into the sampled map
+///! and dynamic casters are drawn over it only when either of them changed in that face, so
+///! their cost doesn't grow with the static scene.
+///! Faces served from cache and rendered again are counted in `context::stats_t`
+struct shadow_map
+{
+public:
+    ///! must be inserted into fragment shader after default float precision. `dg_shadow` gives
+    ///! 0 for fully shadowed and 1 for lit world position
+    static constexpr std::string_view glsl_declarations = R"(
+layout (std140, binding = 2) uniform dg_shadow_params
+{
+    highp vec4 dg_shadow_light;
+    highp vec4 dg_shadow_depth;
+};
+
+layout (binding = 7) uniform highp samplerCubeShadow dg_shadow_map;
+
+float dg_shadow(highp vec3 world_position)
+{
+    highp vec3 d = world_position - dg_shadow_light.xyz;
+    highp vec3 a = abs(d);
+    highp float z = max(a.x, max(a.y, a.z));
+    // window depth of the face projection, see `shadow_map::update`
+    highp float n = dg_shadow_depth.x;
+    highp float f = dg_shadow_depth.y;
+    highp float ndc = (f + n) / (f - n) - 2.0f * f * n / ((f - n) * z);
+    return texture(dg_shadow_map, vec4(d, ndc * 0.5f + 0.5f - dg_shadow_depth.z));
+}
+)";
+    static constexpr uint32_t params_binding{ 2 };
+    static constexpr uint32_t texture_unit{ 7 };
+
+    struct caster
+    {
+        draw_item mesh;
+        ///! world space, faces whose frustum it misses skip the caster
+        aabb bounds;
+    };
+
+    /*
+     * @throws `shader_program::error`, `buffer::error`, `texture::error`, `framebuffer::error`
+     */
+    explicit shadow_map(context& ctx, uint32_t size = 1024, float near_plane = 0.05f,
+                        float far_plane = 50.0f, float bias = 0.0005f);
+
+    shadow_map(shadow_map const&) = delete;
+    shadow_map(shadow_map&&) = delete;
+
+    shadow_map& operator=(shadow_map const&) = delete;
+    shadow_map& operator=(shadow_map&&) = delete;
+
+    ///! brings the map up to date and binds it to `texture_unit`. Static casters are compared
+    ///! with those of the previous call by position in the span, so their order must be stable.
+    ///! Viewport is restored afterwards
+    void update(glm::vec3 const& light_position, std::span<caster const> static_casters,
+                std::span<caster const> dynamic_casters);
+    ///! renders all faces of the cache on next update, e.g. when static meshes are reloaded
+    void invalidate();
+
+    ///! view projection of cube face in `GL_TEXTURE_CUBE_MAP_POSITIVE_X + face` order
+    [[nodiscard]] glm::mat4 const& face_view_proj(uint32_t face) const;
+
+    ///! std140 layout, must match `dg_shadow_params`
+    struct params
+    {
+        ///! xyz is light position
+        glm::vec4 light{ 0.0f };
+        ///! near plane, far plane and depth bias
+        glm::vec4 depth{ 0.0f };
+    };
+
+private:
+    void invalidate_faces(aabb const& box);
+    void draw(uint32_t face, std::span<caster const> casters);
+
+    context& ctx;
+    shader_program program;
+    pipeline_state pipeline;
+    uniform_block<params> params_block;
+
+    float z_near;
+    float z_far;
+    float depth_bias;
+    uint32_t extent;
+
+    texture static_map;
+    texture sampled_map;
+    framebuffer render_target;
+
+    std::array<glm::mat4, 6> view_projs{};
+    std::array<bool, 6> is_face_cached{};
+    ///! faces of `sampled_map` with dynamic casters drawn by last update, the cache must be
+    ///! copied over them again even without dynamic casters now
+    std::array<bool, 6> has_face_dynamic{};
+    bool is_light_known{ false };
+    glm::vec3 cached_light{ 0.0f };
+    std::vector<caster> cached_casters;
+};
+
+} // namespace dg
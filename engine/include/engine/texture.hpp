@@ -0,0 +1,105 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+namespace dg
+{
+
+struct context;
+
+struct texture
+{
+public:
+    struct error : public std::runtime_error
+    {
+        explicit error(std::string const&);
+        error(char const*);
+    };
+
+    enum class target_t
+    {
+        texture_2d,
+        texture_2d_array,
+        ///! 6 layers, in `GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer` order
+        texture_cube_map
+    };
+
+    enum class format_t
+    {
+        rgba8,
+        srgb8_alpha8,
+        etc2_rgb8,
+        etc2_rgba8,
+        astc_4x4,
+        astc_6x6,
+        astc_8x8,
+        ///! sampled with depth comparison, e.g. by `samplerCubeShadow`, see `depth_compare`
+        depth24,
+        ///! unsigned integer, always filtered as nearest, e.g. for ids or packed normals
+        r32ui,
+        rg16ui
+    };
+
+    [[nodiscard]] static bool is_compressed(format_t format);
+    ///! size in bytes of one layer of mip `level`
+    [[nodiscard]] static std::size_t level_size(format_t format, glm::u32vec2 size, uint32_t level);
+
+    ///! allocates immutable storage for `levels` mips, `layers` is used only for `texture_2d_array`.
+    ///! Depth textures and cube maps are clamped to edge
+    texture(context& ctx, target_t target, format_t format, glm::u32vec2 size, uint32_t levels,
+            uint32_t layers = 1);
+
+    texture(texture const&) = delete;
+    texture(texture&&);
+
+    ///! by value is both copy and move assignment, so no other overload may be declared
+    texture& operator=(texture);
+
+    ~texture();
+
+    ///! `data` must be exactly `level_size(format, size, level)` bytes
+    void upload(uint32_t level, uint32_t layer, std::span<std::byte const> data);
+
+    ///! restricts sampling to levels `[level, levels)`, used while finer mips aren't uploaded yet
+    void base_level(uint32_t level);
+
+    void bind_unit(uint32_t unit);
+    ///! on by default for depth formats. Off, depth values are read as they are, e.g. by
+    ///! `texelFetch`, and filtered as nearest, since GLES requires it then
+    void depth_compare(bool is_enabled);
+
+    ///! attaches `layer` of level 0 to bound framebuffer, as depth attachment for depth formats
+    ///! and as color attachment `color_index` otherwise, see `framebuffer::attach`
+    void attach(uint32_t layer, uint32_t color_index = 0);
+    ///! copies all levels and layers on GPU, `dst` must have the same format and size
+    void copy_to(texture& dst) const;
+    ///! copies all levels of one `layer`, e.g. a cube face
+    void copy_to(texture& dst, uint32_t layer) const;
+
+    [[nodiscard]] glm::u32vec2 size() const;
+    [[nodiscard]] uint32_t levels() const;
+    [[nodiscard]] uint32_t layers() const;
+    [[nodiscard]] format_t format() const;
+
+    using bind_state_t = uint32_t;
+    bind_state_t bind();
+    void unbind(bind_state_t prev);
+
+private:
+    context* ctx{ nullptr };
+
+    using handle_t = uint32_t;
+    handle_t handle{ 0 };
+    target_t target{ target_t::texture_2d };
+    format_t fmt{ format_t::rgba8 };
+    glm::u32vec2 extent{ 0 };
+    uint32_t level_count{ 0 };
+    uint32_t layer_count{ 0 };
+};
+
+} // namespace dg
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <engine/texture.hpp>
+
+#include <glm/vec2.hpp>
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace dg
+{
+
+enum class image_t
+{
+    ///! png, jpg, tga, etc. decoded to rgba8 with mips generated on CPU
+    raster,
+    ///! KTX 1.1 container with precompressed mips, e.g. ETC2 or ASTC
+    ktx,
+};
+
+struct image
+{
+    texture::format_t format{ texture::format_t::rgba8 };
+    glm::u32vec2 size{ 0 };
+    ///! `levels[0]` is the finest one
+    std::vector<std::vector<std::byte>> levels;
+};
+
+///! doesn't touch GL, so it is safe to call from worker threads
+std::optional<image> load(image_t type, std::filesystem::path const& filename);
+///! same as `load`, but from contents of a file already in memory, `name` is used only in logs
+std::optional<image> decode(image_t type, std::span<std::byte const> data,
+                            std::string const& name = "image");
+
+} // namespace dg
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <engine/texture.hpp>
+#include <engine/texture_loader.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace dg
+{
+
+struct context;
+struct thread_pool;
+
+///! decodes images on worker threads and uploads them to GL on the caller thread,
+///! coarsest mip first, so textures become usable early and never stall a frame
+struct texture_streamer
+{
+public:
+    texture_streamer(context& ctx, thread_pool& pool);
+
+    texture_streamer(texture_streamer const&) = delete;
+    texture_streamer(texture_streamer&&) = delete;
+
+    texture_streamer& operator=(texture_streamer const&) = delete;
+    texture_streamer& operator=(texture_streamer&&) = delete;
+
+    ~texture_streamer();
+
+    using id = uint32_t;
+
+    id load(image_t type, std::filesystem::path const& filename);
+    ///! all layers must have the same size and format
+    id load_array(image_t type, std::vector<std::filesystem::path> filenames);
+
+    ///! must be called once per frame from GL thread, uploads at most `budget` bytes,
+    ///! though at least one mip level to guarantee progress
+    void pump(std::size_t budget);
+
+    ///! `nullptr` until at least the coarsest mip level is uploaded
+    [[nodiscard]] texture* get(id i);
+    [[nodiscard]] bool is_complete(id i) const;
+    [[nodiscard]] bool is_failed(id i) const;
+
+private:
+    struct request
+    {
+        image_t type{ image_t::raster };
+        texture::target_t target{ texture::target_t::texture_2d };
+        std::vector<std::filesystem::path> filenames;
+
+        // written by worker, published by `is_decoded`
+        std::vector<image> layers;
+        bool is_failed{ false };
+        std::atomic<bool> is_decoded{ false };
+
+        std::optional<texture> tex;
+        ///! next level to upload, counts down to 0, equals -1 when all levels are resident
+        int32_t next_level{ -1 };
+    };
+
+    static void decode(request& r);
+    id enqueue(std::shared_ptr<request> r);
+    bool allocate(request& r);
+
+    context& ctx;
+    thread_pool& pool;
+    std::vector<std::shared_ptr<request>> requests;
+};
+
+} // namespace dg
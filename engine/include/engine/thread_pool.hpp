@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dg
+{
+
+struct thread_pool
+{
+public:
+    ///! by default leaves one hardware thread for the caller
+    explicit thread_pool(std::size_t threads = default_size());
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool(thread_pool&&) = delete;
+
+    thread_pool& operator=(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool&&) = delete;
+
+    ~thread_pool();
+
+    void submit(std::function<void()> job);
+
+    ///! splits `[0, count)` into chunks of at least `min_chunk` elements and
+    ///! blocks until all are processed, the caller thread takes a chunk too.
+    ///! must not be called from inside of pool job.
+    ///! if `fn` throws, the rest of chunks still run and the first exception is rethrown here
+    void parallel_for(std::size_t count, std::function<void(std::size_t begin, std::size_t end)> const& fn,
+                      std::size_t min_chunk = 1);
+
+    [[nodiscard]] std::size_t size() const;
+
+    static std::size_t default_size();
+
+private:
+    void run(std::stop_token token);
+
+    std::mutex mutex;
+    std::condition_variable_any cv;
+    std::deque<std::function<void()>> jobs;
+    std::vector<std::jthread> workers;
+};
+
+} // namespace dg
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace dg
+{
+
+///! parent/child transforms stored as structure of arrays. Parent is always added before its
+///! children, so arrays are in topological order and one linear pass updates whole hierarchy.
+///! Only nodes changed since last `update` and their subtrees are recomputed
+struct transform_hierarchy
+{
+public:
+    using node_id = uint32_t;
+    static constexpr node_id no_parent{ ~node_id{ 0 } };
+
+    ///! `parent` must be already added or `no_parent`
+    node_id add(node_id parent = no_parent, glm::vec3 const& translation = glm::vec3{ 0.0f },
+                glm::quat const& rotation = glm::quat{ 1.0f, 0.0f, 0.0f, 0.0f },
+                glm::vec3 const& scale = glm::vec3{ 1.0f });
+
+    ///! setters mark node dirty, world matrices are stale until `update`
+    void translation(node_id id, glm::vec3 const& t);
+    void rotation(node_id id, glm::quat const& r);
+    void scale(node_id id, glm::vec3 const& s);
+
+    ///! starts from the first dirty node, so it costs nothing when nothing changed
+    void update();
+
+    [[nodiscard]] glm::mat4 const& world(node_id id) const;
+    ///! cofactor of upper 3x3 of `world`, i.e. inverse transpose up to positive scale, so
+    ///! normals transformed by it must be normalized
+    [[nodiscard]] glm::mat3 const& normal(node_id id) const;
+    [[nodiscard]] node_id parent(node_id id) const;
+    ///! nodes which world matrix was recomputed by last `update`, e.g. to reupload them
+    [[nodiscard]] std::span<node_id const> changed() const;
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    void mark_dirty(node_id id);
+
+    std::vector<node_id> parents;
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> worlds;
+    std::vector<glm::mat3> normals;
+    std::vector<uint8_t> dirty;
+
+    std::vector<node_id> changed_nodes;
+    ///! local matrices of `changed_nodes`, kept to not reallocate every `update`
+    std::vector<glm::mat4> locals;
+    ///! all nodes before it are clean
+    node_id first_dirty{ no_parent };
+};
+
+} // namespace dg
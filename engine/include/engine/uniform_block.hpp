@@ -0,0 +1,88 @@
+#pragma once
+
+#include <engine/buffer.hpp>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+namespace dg
+{
+
+namespace std140
+{
+
+///! base alignment of types allowed in std140 blocks, missing types (e.g. `glm::mat3`, `bool`)
+///! have layout different from C++ one and fail to compile
+template <class T>
+constexpr std::size_t alignment = 0;
+
+template <>
+inline constexpr std::size_t alignment<float> = 4;
+template <>
+inline constexpr std::size_t alignment<int32_t> = 4;
+template <>
+inline constexpr std::size_t alignment<uint32_t> = 4;
+template <>
+inline constexpr std::size_t alignment<glm::vec2> = 8;
+template <>
+inline constexpr std::size_t alignment<glm::vec3> = 16;
+template <>
+inline constexpr std::size_t alignment<glm::vec4> = 16;
+template <>
+inline constexpr std::size_t alignment<glm::u32vec4> = 16;
+template <>
+inline constexpr std::size_t alignment<glm::mat4> = 16;
+
+} // namespace std140
+
+///! fails compilation if `member` of `type` isn't where std140 puts it
+#define DG_STD140_MEMBER(type, member)                                                             \
+    static_assert(::dg::std140::alignment<decltype(type::member)> != 0,                            \
+                  #type "::" #member " has type not allowed in std140 block");                     \
+    static_assert(offsetof(type, member) % ::dg::std140::alignment<decltype(type::member)> == 0,   \
+                  #type "::" #member " isn't std140 aligned, add padding before it")
+
+///! uniform buffer holding single `T`, which layout must match `layout(std140) uniform` block.
+///! Members are checked with `DG_STD140_MEMBER`, size is checked here
+template <class T>
+struct uniform_block
+{
+public:
+    static_assert(std::is_standard_layout_v<T> && std::is_trivially_copyable_v<T>);
+    static_assert(sizeof(T) % 16 == 0, "std140 block size is rounded up to vec4, add padding");
+
+    uniform_block(context& ctx, uint32_t binding)
+        : buf{ ctx, buffer::target_t::uniform }
+        , index{ binding }
+    {
+        buf.load(buffer::data_t::dynamic, {}, sizeof(T));
+        buf.bind_base(index);
+    }
+
+    ///! uploads whole block, so every program with the block at `binding` sees new data
+    void
+    update(T const& value)
+    {
+        buf.update(0, std::span<T const>{ &value, 1 });
+        buf.bind_base(index);
+    }
+
+    [[nodiscard]] uint32_t
+    binding() const
+    {
+        return index;
+    }
+
+private:
+    buffer buf;
+    uint32_t index{ 0 };
+};
+
+} // namespace dg
@@ -1,4 +1,10 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
 #include <type_traits>
+#include <vector>
 
 namespace dg
 {
@@ -12,6 +18,11 @@ to_underlying(Enum e) noexcept
 
 [[noreturn]] void unimplemented(char const* const msg = nullptr);
 
+///! reads whole file in binary mode, returns empty buffer on error. Safe to call from any thread
+std::vector<std::byte> load_file(std::filesystem::path const& filename);
+///! (over)writes whole file, parent directories are created, returns false on error
+bool save_file(std::filesystem::path const& filename, std::span<std::byte const> data);
+
 [[noreturn]] inline void
 unreachable()
 {
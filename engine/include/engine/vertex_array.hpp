@@ -1,8 +1,5 @@
 #pragma once
 
-#include <engine/bindable.hpp>
-
-#include <any>
 #include <cstdint>
 #include <stdexcept>
 #include <vector>
@@ -13,7 +10,7 @@ namespace dg
 struct context;
 struct mesh;
 
-struct vertex_array : public bindable
+struct vertex_array
 {
 public:
     struct error : public std::runtime_error
@@ -22,7 +19,7 @@ public:
         error(char const*);
     };
 
-    vertex_array(context const& ctx);
+    vertex_array(context& ctx);
 
     vertex_array(vertex_array const&) = delete;
     vertex_array(vertex_array&&);
@@ -31,7 +28,7 @@ public:
     vertex_array& operator=(vertex_array const&) = delete;
     vertex_array& operator=(vertex_array&&) = delete;
 
-    ~vertex_array() override;
+    ~vertex_array();
 
     enum class data_t
     {
@@ -43,15 +40,21 @@ public:
     using vertex_type = float;
     using index_type = uint32_t;
     // TODO: use std::span
-    void load(location loc, data_t type, std::vector<vertex_type> const& vertices);
+    ///! `components` is number of `vertex_type` values per vertex, e.g. 3 for positions, 2 for UVs
+    void load(location loc, data_t type, std::vector<vertex_type> const& vertices, uint32_t components = 3);
     void load_indices(data_t type, std::vector<index_type> const& indices);
 
-    std::any bind() override;
-    void unbind(std::any data) override;
+    using bind_state_t = uint32_t;
+    bind_state_t bind();
+    void unbind(bind_state_t prev);
 
 private:
+    context* ctx{ nullptr };
+
     using handle_t = uint32_t;
     handle_t handle{ 0 };
+    ///! vertex and index buffers owned by this array
+    std::vector<handle_t> buffers;
 };
 
 } // namespace dg
@@ -0,0 +1,179 @@
+#include <engine/bind_guard.hpp>
+#include <engine/buffer.hpp>
+#include <engine/context.hpp>
+#include <engine/deletion_queue.hpp>
+#include <engine/error.hpp>
+#include <engine/gl_state.hpp>
+#include <engine/util.hpp>
+
+#include <glad/glad.h>
+
+#include <cassert>
+#include <cstring>
+
+namespace dg
+{
+
+namespace
+{
+
+GLenum
+gl_target(buffer::target_t target)
+{
+    switch (target)
+    {
+    case buffer::target_t::array:
+        return GL_ARRAY_BUFFER;
+    case buffer::target_t::element_array:
+        return GL_ELEMENT_ARRAY_BUFFER;
+    case buffer::target_t::uniform:
+        return GL_UNIFORM_BUFFER;
+    case buffer::target_t::shader_storage:
+        return GL_SHADER_STORAGE_BUFFER;
+    case buffer::target_t::draw_indirect:
+        return GL_DRAW_INDIRECT_BUFFER;
+    case buffer::target_t::pixel_pack:
+        return GL_PIXEL_PACK_BUFFER;
+    }
+
+    unreachable();
+}
+
+} // namespace
+
+buffer::error::error(std::string const& msg)
+    : std::runtime_error(msg)
+{
+}
+
+buffer::error::error(char const* msg)
+    : std::runtime_error(msg)
+{
+}
+
+buffer::buffer(context& c, target_t target)
+    : ctx(&c)
+    , type(target)
+{
+    GL_CHECK(glGenBuffers(1, &handle));
+    if (handle == 0)
+    {
+        throw error("error occurs creating buffer");
+    }
+}
+
+buffer::buffer(buffer&& other)
+    : ctx(other.ctx)
+    , handle(other.handle)
+    , type(other.type)
+    , bytes(other.bytes)
+{
+    other.handle = 0;
+    other.bytes = 0;
+}
+
+buffer&
+buffer::operator=(buffer other)
+{
+    using std::swap;
+
+    swap(ctx, other.ctx);
+    swap(handle, other.handle);
+    swap(type, other.type);
+    swap(bytes, other.bytes);
+
+    return *this;
+}
+
+buffer::~buffer()
+{
+    if (ctx) ctx->deletions().push(deletion_queue::object_t::buffer, handle);
+}
+
+void
+buffer::load(data_t type, std::span<std::byte const> data, std::size_t size)
+{
+    bind_guard _{ *this };
+
+    // clang-format off
+    GLenum const draw_type = type == data_t::immutable ? GL_STATIC_DRAW
+                           : type == data_t::dynamic ? GL_DYNAMIC_DRAW
+                           : type == data_t::stream  ? GL_STREAM_DRAW
+                           : type == data_t::readback ? GL_STREAM_READ
+                           : 0;
+    // clang-format on
+    assert(draw_type != 0);
+
+    bytes = data.empty() ? size : data.size();
+    GL_CHECK(glBufferData(gl_target(this->type), static_cast<GLsizeiptr>(bytes),
+                          data.empty() ? nullptr : data.data(), draw_type));
+}
+
+void
+buffer::update(std::size_t offset, std::span<std::byte const> data)
+{
+    assert(offset + data.size() <= bytes);
+
+    bind_guard _{ *this };
+
+    GL_CHECK(glBufferSubData(gl_target(type), static_cast<GLintptr>(offset),
+                             static_cast<GLsizeiptr>(data.size()), data.data()));
+}
+
+void
+buffer::read(std::size_t offset, std::span<std::byte> out)
+{
+    assert(offset + out.size() <= bytes);
+
+    bind_guard _{ *this };
+
+    void const* mapped{ nullptr };
+    GL_CHECK(mapped = glMapBufferRange(gl_target(type), static_cast<GLintptr>(offset),
+                                       static_cast<GLsizeiptr>(out.size()), GL_MAP_READ_BIT));
+    if (!mapped)
+    {
+        throw error("error occurs mapping buffer for reading");
+    }
+    std::memcpy(out.data(), mapped, out.size());
+    GL_CHECK(glUnmapBuffer(gl_target(type)));
+}
+
+void
+buffer::bind_base(uint32_t index)
+{
+    bind_base(type, index);
+}
+
+void
+buffer::bind_base(target_t target, uint32_t index)
+{
+    assert(target == target_t::uniform || target == target_t::shader_storage);
+
+    ctx->state().bind_buffer_base(target, index, handle);
+}
+
+std::size_t
+buffer::size() const
+{
+    return bytes;
+}
+
+buffer::target_t
+buffer::target() const
+{
+    return type;
+}
+
+buffer::bind_state_t
+buffer::bind()
+{
+    return ctx->state().bind_buffer(type, handle);
+}
+
+void
+buffer::unbind(bind_state_t prev)
+{
+    ctx->state().bind_buffer(type, prev);
+}
+
+} // namespace dg
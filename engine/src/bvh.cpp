@@ -0,0 +1,452 @@
+#include <engine/bvh.hpp>
+#include <engine/frustum.hpp>
+#include <engine/mesh.hpp>
+#include <engine/thread_pool.hpp>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <ranges>
+#include <utility>
+
+namespace dg
+{
+
+namespace
+{
+
+constexpr std::size_t bin_count{ 16 };
+// nodes this deep are always leaves, so traversal stacks have fixed size
+constexpr std::size_t max_depth{ 64 };
+
+std::size_t
+bin_index(float centroid, float min, float scale)
+{
+    return std::min(bin_count - 1, static_cast<std::size_t>((centroid - min) * scale));
+}
+
+///! distance where `r` enters `[min, max]`, or nothing. `inv_dir` is `1 / r.direction`
+std::optional<float>
+slab(glm::vec3 const& min, glm::vec3 const& max, glm::vec3 const& origin, glm::vec3 const& inv_dir,
+     float max_distance)
+{
+    glm::vec3 const t0{ (min - origin) * inv_dir };
+    glm::vec3 const t1{ (max - origin) * inv_dir };
+    glm::vec3 const near{ glm::min(t0, t1) };
+    glm::vec3 const far{ glm::max(t0, t1) };
+
+    float const enter{ std::max({ near.x, near.y, near.z, 0.0f }) };
+    float const exit{ std::min({ far.x, far.y, far.z, max_distance }) };
+    if (enter > exit) return std::nullopt;
+
+    return enter;
+}
+
+///! Moller-Trumbore, distance along `r` in units of its direction
+std::optional<float>
+intersect_triangle(ray const& r, glm::vec3 const& a, glm::vec3 const& b, glm::vec3 const& c)
+{
+    glm::vec3 const ab{ b - a };
+    glm::vec3 const ac{ c - a };
+    glm::vec3 const p{ glm::cross(r.direction, ac) };
+    float const det{ glm::dot(ab, p) };
+    if (std::abs(det) < std::numeric_limits<float>::epsilon()) return std::nullopt;
+
+    float const inv_det{ 1.0f / det };
+    glm::vec3 const s{ r.origin - a };
+    float const u{ glm::dot(s, p) * inv_det };
+    if (u < 0.0f || u > 1.0f) return std::nullopt;
+
+    glm::vec3 const q{ glm::cross(s, ab) };
+    float const v{ glm::dot(r.direction, q) * inv_det };
+    if (v < 0.0f || u + v > 1.0f) return std::nullopt;
+
+    float const t{ glm::dot(ac, q) * inv_det };
+    if (t < 0.0f) return std::nullopt;
+
+    return t;
+}
+
+} // namespace
+
+void
+aabb::grow(glm::vec3 const& p)
+{
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+}
+
+void
+aabb::grow(aabb const& box)
+{
+    min = glm::min(min, box.min);
+    max = glm::max(max, box.max);
+}
+
+glm::vec3
+aabb::center() const
+{
+    return (min + max) * 0.5f;
+}
+
+float
+aabb::half_area() const
+{
+    glm::vec3 const e{ glm::max(max - min, glm::vec3{ 0.0f }) };
+
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+bool
+aabb::overlaps(aabb const& box) const
+{
+    return min.x <= box.max.x && max.x >= box.min.x && min.y <= box.max.y && max.y >= box.min.y
+           && min.z <= box.max.z && max.z >= box.min.z;
+}
+
+aabb
+aabb::transformed(glm::mat4 const& m) const
+{
+    // Arvo: every output axis is translation plus min/max of each column's contribution
+    aabb res;
+    res.min = res.max = glm::vec3(m[3]);
+    for (glm::length_t c{ 0 }; c < 3; ++c)
+    {
+        glm::vec3 const a{ glm::vec3(m[c]) * min[c] };
+        glm::vec3 const b{ glm::vec3(m[c]) * max[c] };
+        res.min += glm::min(a, b);
+        res.max += glm::max(a, b);
+    }
+
+    return res;
+}
+
+void
+bvh::build(std::span<aabb const> bounds, uint32_t max_leaf_size)
+{
+    tree.clear();
+    boxes.clear();
+    primitives.resize(bounds.size());
+    for (std::size_t i{ 0 }; i < bounds.size(); ++i) primitives[i] = static_cast<primitive_id>(i);
+    if (bounds.empty()) return;
+
+    std::vector<glm::vec3> centroids(bounds.size());
+    std::ranges::transform(bounds, centroids.begin(), &aabb::center);
+
+    // binary tree with `n` leaves at most has `2n - 1` nodes, so references stay valid
+    tree.reserve(2 * bounds.size() - 1);
+    tree.push_back({ .first = 0, .count = static_cast<uint32_t>(bounds.size()) });
+
+    // node index and its depth
+    std::vector<std::pair<uint32_t, std::size_t>> pending{ { 0, 0 } };
+    while (!pending.empty())
+    {
+        auto const [index, depth] = pending.back();
+        pending.pop_back();
+        node& n = tree[index];
+
+        aabb box;
+        aabb centroid_box;
+        for (uint32_t i{ n.first }; i < n.first + n.count; ++i)
+        {
+            box.grow(bounds[primitives[i]]);
+            centroid_box.grow(centroids[primitives[i]]);
+        }
+        n.min = box.min;
+        n.max = box.max;
+        if (n.count <= max_leaf_size || depth + 1 == max_depth) continue;
+
+        // binned SAH: primitives are put into bins by centroid, every bin border is a candidate
+        struct bin
+        {
+            aabb box;
+            uint32_t count{ 0 };
+        };
+
+        float best_cost{ std::numeric_limits<float>::max() };
+        glm::length_t best_axis{ 0 };
+        std::size_t best_split{ 0 };
+        glm::vec3 const extent{ centroid_box.max - centroid_box.min };
+        for (glm::length_t axis{ 0 }; axis < 3; ++axis)
+        {
+            if (extent[axis] <= 0.0f) continue;
+
+            float const scale{ static_cast<float>(bin_count) / extent[axis] };
+            std::array<bin, bin_count> bins{};
+            for (uint32_t i{ n.first }; i < n.first + n.count; ++i)
+            {
+                primitive_id const p{ primitives[i] };
+                auto const b = bin_index(centroids[p][axis], centroid_box.min[axis], scale);
+                bins[b].box.grow(bounds[p]);
+                ++bins[b].count;
+            }
+
+            // right to left sweep stores costs of right sides, left to right one completes them
+            std::array<float, bin_count - 1> right_cost{};
+            aabb right;
+            uint32_t right_count{ 0 };
+            for (std::size_t b{ bin_count - 1 }; b > 0; --b)
+            {
+                right.grow(bins[b].box);
+                right_count += bins[b].count;
+                right_cost[b - 1] = right_count == 0 ? 0.0f : right.half_area() * right_count;
+            }
+
+            aabb left;
+            uint32_t left_count{ 0 };
+            for (std::size_t b{ 0 }; b + 1 < bin_count; ++b)
+            {
+                left.grow(bins[b].box);
+                left_count += bins[b].count;
+                if (left_count == 0 || left_count == n.count) continue;
+
+                float const cost{ left.half_area() * left_count + right_cost[b] };
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = b;
+                }
+            }
+        }
+
+        // unit traversal and intersection costs, leaf is kept when splitting doesn't pay off
+        float const leaf_cost{ static_cast<float>(n.count) };
+        float const split_cost{ 1.0f + best_cost / std::max(box.half_area(), 1e-20f) };
+        if (best_cost == std::numeric_limits<float>::max() || split_cost >= leaf_cost) continue;
+
+        float const scale{ static_cast<float>(bin_count) / extent[best_axis] };
+        auto const first = primitives.begin() + n.first;
+        float const axis_min{ centroid_box.min[best_axis] };
+        auto const middle = std::partition(
+            first, first + n.count, [&](primitive_id p)
+            { return bin_index(centroids[p][best_axis], axis_min, scale) <= best_split; });
+        auto const left_count = static_cast<uint32_t>(middle - first);
+        assert(left_count != 0 && left_count != n.count);
+
+        auto const left = static_cast<uint32_t>(tree.size());
+        tree.push_back({ .first = n.first, .count = left_count });
+        tree.push_back({ .first = n.first + left_count, .count = n.count - left_count });
+        n.first = left;
+        n.count = 0;
+
+        pending.emplace_back(left, depth + 1);
+        pending.emplace_back(left + 1, depth + 1);
+    }
+
+    boxes.resize(primitives.size());
+    for (std::size_t i{ 0 }; i < primitives.size(); ++i) boxes[i] = bounds[primitives[i]];
+}
+
+void
+bvh::refit(std::span<aabb const> bounds)
+{
+    assert(bounds.size() == primitives.size());
+
+    // children are always after their parent, so reverse order is bottom up
+    for (auto& n : tree | std::views::reverse)
+    {
+        aabb box;
+        if (n.count != 0)
+        {
+            for (uint32_t i{ n.first }; i < n.first + n.count; ++i)
+            {
+                boxes[i] = bounds[primitives[i]];
+                box.grow(boxes[i]);
+            }
+        } else
+        {
+            box.grow(aabb{ tree[n.first].min, tree[n.first].max });
+            box.grow(aabb{ tree[n.first + 1].min, tree[n.first + 1].max });
+        }
+        n.min = box.min;
+        n.max = box.max;
+    }
+}
+
+void
+bvh::query(aabb const& box, std::vector<primitive_id>& out) const
+{
+    out.clear();
+    if (tree.empty()) return;
+
+    std::array<uint32_t, max_depth> stack;
+    std::size_t top{ 0 };
+    stack[top++] = 0;
+    while (top != 0)
+    {
+        node const& n = tree[stack[--top]];
+        if (!box.overlaps(aabb{ n.min, n.max })) continue;
+
+        if (n.count != 0)
+        {
+            for (uint32_t i{ n.first }; i < n.first + n.count; ++i)
+            {
+                if (box.overlaps(boxes[i])) out.push_back(primitives[i]);
+            }
+            continue;
+        }
+        assert(top + 2 <= stack.size());
+        stack[top++] = n.first;
+        stack[top++] = n.first + 1;
+    }
+}
+
+void
+bvh::query(frustum const& f, std::vector<primitive_id>& out) const
+{
+    out.clear();
+    if (tree.empty()) return;
+
+    std::array<uint32_t, max_depth> stack;
+    std::size_t top{ 0 };
+    stack[top++] = 0;
+    while (top != 0)
+    {
+        node const& n = tree[stack[--top]];
+        if (!f.intersects_aabb(n.min, n.max)) continue;
+
+        if (n.count != 0)
+        {
+            for (uint32_t i{ n.first }; i < n.first + n.count; ++i)
+            {
+                if (f.intersects_aabb(boxes[i].min, boxes[i].max)) out.push_back(primitives[i]);
+            }
+            continue;
+        }
+        assert(top + 2 <= stack.size());
+        stack[top++] = n.first;
+        stack[top++] = n.first + 1;
+    }
+}
+
+std::optional<bvh::hit>
+bvh::raycast(ray const& r, hit_test const& test, float max_distance) const
+{
+    if (tree.empty()) return std::nullopt;
+
+    // division by zero gives infinities, which slab test handles
+    glm::vec3 const inv_dir{ 1.0f / r.direction };
+
+    std::optional<hit> closest;
+    std::array<uint32_t, max_depth> stack;
+    std::size_t top{ 0 };
+    if (!slab(tree[0].min, tree[0].max, r.origin, inv_dir, max_distance)) return std::nullopt;
+    stack[top++] = 0;
+    while (top != 0)
+    {
+        node const& n = tree[stack[--top]];
+        if (n.count != 0)
+        {
+            for (uint32_t i{ n.first }; i < n.first + n.count; ++i)
+            {
+                if (!slab(boxes[i].min, boxes[i].max, r.origin, inv_dir, max_distance)) continue;
+
+                auto const distance = test(primitives[i], max_distance);
+                if (distance && *distance < max_distance)
+                {
+                    max_distance = *distance;
+                    closest = hit{ .primitive = primitives[i], .distance = *distance };
+                }
+            }
+            continue;
+        }
+
+        // both children are tested here, so nodes on stack are always hit
+        auto const left = slab(tree[n.first].min, tree[n.first].max, r.origin, inv_dir,
+                               max_distance);
+        auto const right = slab(tree[n.first + 1].min, tree[n.first + 1].max, r.origin, inv_dir,
+                                max_distance);
+        assert(top + 2 <= stack.size());
+        if (left && right)
+        {
+            // nearer child is popped first
+            bool const is_left_near{ *left <= *right };
+            stack[top++] = is_left_near ? n.first + 1 : n.first;
+            stack[top++] = is_left_near ? n.first : n.first + 1;
+        } else if (left)
+        {
+            stack[top++] = n.first;
+        } else if (right)
+        {
+            stack[top++] = n.first + 1;
+        }
+    }
+
+    return closest;
+}
+
+std::span<bvh::node const>
+bvh::nodes() const
+{
+    return tree;
+}
+
+std::size_t
+bvh::size() const
+{
+    return primitives.size();
+}
+
+mesh_bvh::mesh_bvh(mesh const& m, uint32_t max_leaf_size)
+{
+    auto const vertex = [&m](mesh::index_type i)
+    { return glm::vec3{ m.vertices[3 * i], m.vertices[3 * i + 1], m.vertices[3 * i + 2] }; };
+
+    std::size_t const count{ m.indices.size() / 3 };
+    triangles.reserve(count * 3);
+    std::vector<aabb> bounds(count);
+    for (std::size_t t{ 0 }; t < count; ++t)
+    {
+        for (std::size_t v{ 0 }; v < 3; ++v)
+        {
+            glm::vec3 const p{ vertex(m.indices[3 * t + v]) };
+            triangles.push_back(p);
+            bounds[t].grow(p);
+        }
+        box.grow(bounds[t]);
+    }
+
+    tree.build(bounds, max_leaf_size);
+}
+
+std::vector<mesh_bvh>
+mesh_bvh::build(thread_pool& pool, std::span<mesh const* const> meshes)
+{
+    std::vector<mesh_bvh> res(meshes.size());
+    pool.parallel_for(meshes.size(),
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t i{ begin }; i < end; ++i)
+                          {
+                              res[i] = mesh_bvh{ *meshes[i] };
+                          }
+                      });
+
+    return res;
+}
+
+std::optional<bvh::hit>
+mesh_bvh::raycast(ray const& r, float max_distance) const
+{
+    return tree.raycast(
+        r,
+        [&](bvh::primitive_id t, float) -> std::optional<float>
+        {
+            return intersect_triangle(r, triangles[3 * t], triangles[3 * t + 1],
+                                      triangles[3 * t + 2]);
+        },
+        max_distance);
+}
+
+aabb
+mesh_bvh::bounds() const
+{
+    return box;
+}
+
+} // namespace dg
@@ -1,5 +1,7 @@
 #include <engine/context.hpp>
+#include <engine/deletion_queue.hpp>
 #include <engine/error.hpp>
+#include <engine/gl_state.hpp>
 #include <engine/util.hpp>
 
 #include <SDL3/SDL.h>
@@ -8,11 +10,41 @@
 
 #include <glad/glad.h>
 
+#include <algorithm>
 #include <format>
+#include <functional>
+#include <string>
+#include <vector>
 
 namespace dg
 {
 
+namespace
+{
+
+// extensions aren't in glad, which is generated for core only
+using max_shader_compiler_threads_fn = void (*)(GLuint);
+
+std::vector<std::string>
+query_extensions()
+{
+    GLint count{ 0 };
+    GL_CHECK(glGetIntegerv(GL_NUM_EXTENSIONS, &count));
+
+    std::vector<std::string> extensions;
+    extensions.reserve(static_cast<std::size_t>(count));
+    for (GLint i{ 0 }; i < count; ++i)
+    {
+        auto const* const name = glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i));
+        if (name) extensions.emplace_back(reinterpret_cast<char const*>(name));
+    }
+    std::ranges::sort(extensions);
+
+    return extensions;
+}
+
+} // namespace
+
 context::error::error(std::string const& msg)
     : std::runtime_error(msg)
 {
@@ -27,6 +59,14 @@ struct context::internal_data
 {
     SDL_Window* sdl_window = nullptr;
     SDL_GLContext gl_context = nullptr;
+    std::filesystem::path cache_path;
+    ///! sorted
+    std::vector<std::string> extensions;
+
+    stats_t stats{};
+    stats_t last_stats{};
+    gl_state state{ stats };
+    deletion_queue deletions{ state };
 };
 
 void
@@ -34,6 +74,10 @@ context::internal_data_deleter::operator()(internal_data* data)
 {
     if (data)
     {
+        if (data->gl_context)
+        {
+            data->deletions.flush();
+        }
         if (data->sdl_window)
         {
             SDL_DestroyWindow(static_cast<SDL_Window*>(data->sdl_window));
@@ -108,25 +152,29 @@ context::context(char const* const title, glm::u32vec2 size)
         GL_CHECK(glViewport(0, 0, w, h));
     }
 
-    auto* const p = new internal_data{ .sdl_window = sdl_window, .gl_context = gl_context };
-    data.reset(p);
-
-    ctx = this;
-}
-
-context::context(context&& ctx)
-    : data(std::move(ctx.data))
-{
-}
+    auto extensions = query_extensions();
+    if (std::ranges::binary_search(extensions, "GL_KHR_parallel_shader_compile"))
+    {
+        // let driver pick number of threads, default may be 0 on some drivers
+        auto const max_threads = reinterpret_cast<max_shader_compiler_threads_fn>(
+            SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR"));
+        if (max_threads) GL_CHECK(max_threads(0xFFFFFFFF));
+    }
 
-context&
-context::operator=(context ctx)
-{
-    using std::swap;
+    std::filesystem::path cache_path;
+    if (char* const pref = SDL_GetPrefPath("dg", title))
+    {
+        cache_path = pref;
+        SDL_free(pref);
+    }
 
-    swap(data, ctx.data);
+    auto* const p = new internal_data{ .sdl_window = sdl_window,
+                                       .gl_context = gl_context,
+                                       .cache_path = std::move(cache_path),
+                                       .extensions = std::move(extensions) };
+    data.reset(p);
 
-    return *this;
+    ctx = this;
 }
 
 context::~context() { ctx = nullptr; }
@@ -135,6 +183,11 @@ void
 context::swap_window()
 {
     SDL_GL_SwapWindow(data->sdl_window);
+
+    data->deletions.end_frame();
+
+    data->last_stats = data->stats;
+    data->stats = stats_t{};
 }
 
 context::buffer
@@ -178,6 +231,18 @@ context::window_size() const
     return { w, h };
 }
 
+glm::u32vec2
+context::drawable_size() const
+{
+    int w{ 0 }, h{ 0 };
+    if (0 != SDL_GetWindowSizeInPixels(data->sdl_window, &w, &h))
+    {
+        throw error(std::format("error getting window size in pixels: {}", SDL_GetError()));
+    }
+
+    return { w, h };
+}
+
 std::filesystem::path
 context::resources_path()
 {
@@ -188,17 +253,28 @@ context::resources_path()
 #endif
 }
 
+std::filesystem::path const&
+context::cache_path() const
+{
+    return data->cache_path;
+}
+
+bool
+context::has_extension(std::string_view name) const
+{
+    return std::ranges::binary_search(data->extensions, name, std::less<>{});
+}
+
 void
 context::enable(capability c)
 {
-    switch (c)
-    {
-    case capability::depth_test:
-        GL_CHECK(glEnable(GL_DEPTH_TEST));
-        return;
-    }
+    data->state.enable(c, true);
+}
 
-    unreachable();
+void
+context::disable(capability c)
+{
+    data->state.enable(c, false);
 }
 
 void
@@ -213,4 +289,28 @@ context::window_mouse_position(glm::vec2 pos)
     SDL_WarpMouseInWindow(data->sdl_window, pos.x, pos.y);
 }
 
+deletion_queue&
+context::deletions()
+{
+    return data->deletions;
+}
+
+gl_state&
+context::state()
+{
+    return data->state;
+}
+
+context::stats_t const&
+context::stats() const
+{
+    return data->last_stats;
+}
+
+context::stats_t&
+context::frame_stats()
+{
+    return data->stats;
+}
+
 } // namespace dg
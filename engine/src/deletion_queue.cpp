@@ -0,0 +1,133 @@
+#include <engine/deletion_queue.hpp>
+#include <engine/error.hpp>
+#include <engine/gl_state.hpp>
+#include <engine/util.hpp>
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+namespace dg
+{
+
+namespace
+{
+
+bool
+is_empty(auto const& handles)
+{
+    return std::ranges::all_of(handles, [](auto const& v) { return v.empty(); });
+}
+
+} // namespace
+
+deletion_queue::deletion_queue(gl_state& s)
+    : state(s)
+{
+}
+
+void
+deletion_queue::push(object_t type, handle_t handle)
+{
+    if (handle == 0) return;
+
+    pending[to_underlying(type)].push_back(handle);
+}
+
+void
+deletion_queue::end_frame()
+{
+    if (!is_empty(pending))
+    {
+        GLsync fence{ nullptr };
+        GL_CHECK(fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+        in_flight.push_back(batch{ .fence = fence, .handles = std::move(pending) });
+        pending = handles_t{};
+    }
+
+    while (!in_flight.empty())
+    {
+        auto& b = in_flight.front();
+        auto* const fence = static_cast<GLsync>(b.fence);
+
+        GLint status{ GL_UNSIGNALED };
+        GL_CHECK(glGetSynciv(fence, GL_SYNC_STATUS, sizeof(status), nullptr, &status));
+        if (status != GL_SIGNALED) break;
+
+        GL_CHECK(glDeleteSync(fence));
+        destroy(b.handles);
+        in_flight.pop_front();
+    }
+}
+
+void
+deletion_queue::flush()
+{
+    for (auto& b : in_flight)
+    {
+        GL_CHECK(glDeleteSync(static_cast<GLsync>(b.fence)));
+        destroy(b.handles);
+    }
+    in_flight.clear();
+
+    destroy(pending);
+}
+
+std::size_t
+deletion_queue::size() const
+{
+    std::size_t res{ 0 };
+    auto const count = [&res](handles_t const& handles)
+    {
+        for (auto const& v : handles) res += v.size();
+    };
+
+    count(pending);
+    for (auto const& b : in_flight) count(b.handles);
+
+    return res;
+}
+
+void
+deletion_queue::destroy(handles_t& handles)
+{
+    for (std::size_t i{ 0 }; i < handles.size(); ++i)
+    {
+        auto& h = handles[i];
+        if (h.empty()) continue;
+
+        auto const n = static_cast<GLsizei>(h.size());
+        switch (static_cast<object_t>(i))
+        {
+        case object_t::program:
+            for (auto const p : h) GL_CHECK(glDeleteProgram(p));
+            break;
+        case object_t::vertex_array:
+            GL_CHECK(glDeleteVertexArrays(n, h.data()));
+            break;
+        case object_t::buffer:
+            GL_CHECK(glDeleteBuffers(n, h.data()));
+            break;
+        case object_t::texture:
+            GL_CHECK(glDeleteTextures(n, h.data()));
+            break;
+        case object_t::framebuffer:
+            GL_CHECK(glDeleteFramebuffers(n, h.data()));
+            break;
+        case object_t::renderbuffer:
+            GL_CHECK(glDeleteRenderbuffers(n, h.data()));
+            break;
+        case object_t::query:
+            GL_CHECK(glDeleteQueries(n, h.data()));
+            break;
+        case object_t::count:
+            unreachable();
+        }
+
+        state.forget(static_cast<object_t>(i), h);
+        h.clear();
+    }
+}
+
+} // namespace dg
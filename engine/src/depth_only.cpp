@@ -0,0 +1,32 @@
+#include <engine/depth_only.hpp>
+#include <engine/error.hpp>
+#include <engine/vertex_array.hpp>
+
+#include <glad/glad.h>
+
+namespace dg
+{
+
+shader_program
+depth_only_program(context& ctx, std::string_view fragment_src)
+{
+    shader_program program(ctx);
+    program.attach_from_src(shader_program::shader_t::vertex, depth_only_vertex_shader_src);
+    program.attach_from_src(shader_program::shader_t::fragment, fragment_src);
+    program.link();
+
+    return program;
+}
+
+void
+draw_item::draw(shader_program& program, glm::mat4 const& view_proj) const
+{
+    vao->bind();
+    program.uniform("model_view_proj", view_proj * model);
+
+    auto const offset{ static_cast<uintptr_t>(first_index) * sizeof(uint32_t) };
+    GL_CHECK(glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(index_count), GL_UNSIGNED_INT,
+                            reinterpret_cast<void const*>(offset)));
+}
+
+} // namespace dg
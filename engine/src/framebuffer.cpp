@@ -0,0 +1,140 @@
+#include <engine/bind_guard.hpp>
+#include <engine/context.hpp>
+#include <engine/deletion_queue.hpp>
+#include <engine/error.hpp>
+#include <engine/framebuffer.hpp>
+#include <engine/gl_state.hpp>
+#include <engine/texture.hpp>
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <format>
+
+namespace dg
+{
+
+framebuffer::error::error(std::string const& msg)
+    : std::runtime_error(msg)
+{
+}
+
+framebuffer::error::error(char const* msg)
+    : std::runtime_error(msg)
+{
+}
+
+framebuffer::framebuffer(context& c)
+    : ctx(&c)
+{
+    GL_CHECK(glGenFramebuffers(1, &handle));
+    if (handle == 0)
+    {
+        throw error("error occurs creating framebuffer");
+    }
+}
+
+framebuffer::framebuffer(framebuffer&& other)
+    : ctx(other.ctx)
+    , handle(other.handle)
+    , color_attachments(other.color_attachments)
+    , has_depth(other.has_depth)
+{
+    other.handle = 0;
+}
+
+framebuffer&
+framebuffer::operator=(framebuffer other)
+{
+    using std::swap;
+
+    swap(ctx, other.ctx);
+    swap(handle, other.handle);
+    swap(color_attachments, other.color_attachments);
+    swap(has_depth, other.has_depth);
+
+    return *this;
+}
+
+framebuffer::~framebuffer()
+{
+    if (ctx) ctx->deletions().push(deletion_queue::object_t::framebuffer, handle);
+}
+
+void
+framebuffer::attach(texture& t, uint32_t layer, uint32_t color_index)
+{
+    assert(color_index < max_color_attachments);
+
+    bind_guard _{ *this };
+
+    t.attach(layer, color_index);
+    if (t.format() == texture::format_t::depth24)
+    {
+        has_depth = true;
+    } else
+    {
+        color_attachments |= 1u << color_index;
+    }
+}
+
+void
+framebuffer::draw_buffers(uint32_t count)
+{
+    assert(count <= max_color_attachments);
+
+    bind_guard _{ *this };
+
+    std::array<GLenum, max_color_attachments> buffers{};
+    for (uint32_t i{ 0 }; i < count; ++i) buffers[i] = GL_COLOR_ATTACHMENT0 + i;
+    if (count == 0)
+    {
+        buffers[0] = GL_NONE;
+        GL_CHECK(glReadBuffer(GL_NONE));
+    }
+    GL_CHECK(glDrawBuffers(static_cast<GLsizei>(std::max(count, 1u)), buffers.data()));
+}
+
+void
+framebuffer::validate(std::string_view name)
+{
+    bind_guard _{ *this };
+
+    GLenum status{ 0 };
+    GL_CHECK(status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        throw error(std::format("{} framebuffer is incomplete: {:#x}", name, status));
+    }
+}
+
+void
+framebuffer::invalidate()
+{
+    bind_guard _{ *this };
+
+    std::array<GLenum, max_color_attachments + 1> attachments{};
+    GLsizei count{ 0 };
+    for (uint32_t i{ 0 }; i < max_color_attachments; ++i)
+    {
+        if (color_attachments & (1u << i)) attachments[count++] = GL_COLOR_ATTACHMENT0 + i;
+    }
+    if (has_depth) attachments[count++] = GL_DEPTH_ATTACHMENT;
+    GL_CHECK(glInvalidateFramebuffer(GL_FRAMEBUFFER, count, attachments.data()));
+}
+
+framebuffer::bind_state_t
+framebuffer::bind()
+{
+    return ctx->state().bind_framebuffer(handle);
+}
+
+void
+framebuffer::unbind(bind_state_t prev)
+{
+    ctx->state().bind_framebuffer(prev);
+}
+
+} // namespace dg
@@ -0,0 +1,294 @@
+#include <engine/frustum.hpp>
+#include <engine/thread_pool.hpp>
+#include <engine/util.hpp>
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <limits>
+#include <span>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define DG_FRUSTUM_AVX 1
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define DG_FRUSTUM_SSE 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define DG_FRUSTUM_NEON 1
+#endif
+
+namespace dg
+{
+
+namespace
+{
+
+using planes_t = std::array<glm::vec4, 6>;
+
+///! writes `base + i` for every set bit `i` of `mask`, returns how many were written
+std::size_t
+emit(uint32_t mask, uint32_t base, uint32_t* out)
+{
+    std::size_t n{ 0 };
+    for (; mask != 0; mask &= mask - 1)
+    {
+        out[n++] = base + static_cast<uint32_t>(std::countr_zero(mask));
+    }
+
+    return n;
+}
+
+///! writes ids of visible spheres in `[begin, end)` to `out`, bounds are multiples of lanes.
+///! Sphere is visible when `dot(plane.xyz, center) + plane.w >= -radius` for every plane
+std::size_t
+cull_range(planes_t const& planes, float const* xs, float const* ys, float const* zs,
+           float const* radii, std::size_t begin, std::size_t end, uint32_t* out)
+{
+    assert(begin % sphere_bounds::lanes == 0 && end % sphere_bounds::lanes == 0);
+
+    std::size_t n{ 0 };
+#if defined(DG_FRUSTUM_AVX)
+    // plain array, std::array drops vector type attributes
+    __m256 p[6][4];
+    for (std::size_t i{ 0 }; i < planes.size(); ++i)
+    {
+        for (glm::length_t c{ 0 }; c < 4; ++c) p[i][c] = _mm256_set1_ps(planes[i][c]);
+    }
+
+    for (std::size_t i{ begin }; i < end; i += 8)
+    {
+        __m256 const x{ _mm256_loadu_ps(xs + i) };
+        __m256 const y{ _mm256_loadu_ps(ys + i) };
+        __m256 const z{ _mm256_loadu_ps(zs + i) };
+        __m256 const neg_r{ _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radii + i)) };
+
+        __m256 inside{ _mm256_castsi256_ps(_mm256_set1_epi32(-1)) };
+        for (auto const& [px, py, pz, pw] : p)
+        {
+            __m256 d{ _mm256_add_ps(_mm256_mul_ps(px, x), pw) };
+            d = _mm256_add_ps(d, _mm256_mul_ps(py, y));
+            d = _mm256_add_ps(d, _mm256_mul_ps(pz, z));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, neg_r, _CMP_GE_OQ));
+        }
+
+        auto const mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+        n += emit(mask, static_cast<uint32_t>(i), out + n);
+    }
+#elif defined(DG_FRUSTUM_SSE)
+    // plain array, std::array drops vector type attributes
+    __m128 p[6][4];
+    for (std::size_t i{ 0 }; i < planes.size(); ++i)
+    {
+        for (glm::length_t c{ 0 }; c < 4; ++c) p[i][c] = _mm_set1_ps(planes[i][c]);
+    }
+
+    for (std::size_t i{ begin }; i < end; i += 4)
+    {
+        __m128 const x{ _mm_loadu_ps(xs + i) };
+        __m128 const y{ _mm_loadu_ps(ys + i) };
+        __m128 const z{ _mm_loadu_ps(zs + i) };
+        __m128 const neg_r{ _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radii + i)) };
+
+        __m128 inside{ _mm_cmpeq_ps(x, x) };
+        for (auto const& [px, py, pz, pw] : p)
+        {
+            __m128 d{ _mm_add_ps(_mm_mul_ps(px, x), pw) };
+            d = _mm_add_ps(d, _mm_mul_ps(py, y));
+            d = _mm_add_ps(d, _mm_mul_ps(pz, z));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, neg_r));
+        }
+
+        auto const mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+        n += emit(mask, static_cast<uint32_t>(i), out + n);
+    }
+#elif defined(DG_FRUSTUM_NEON)
+    uint32x4_t const bits{ 1, 2, 4, 8 };
+    for (std::size_t i{ begin }; i < end; i += 4)
+    {
+        float32x4_t const x{ vld1q_f32(xs + i) };
+        float32x4_t const y{ vld1q_f32(ys + i) };
+        float32x4_t const z{ vld1q_f32(zs + i) };
+        float32x4_t const neg_r{ vnegq_f32(vld1q_f32(radii + i)) };
+
+        uint32x4_t inside{ vdupq_n_u32(~0u) };
+        for (auto const& pl : planes)
+        {
+            float32x4_t d{ vfmaq_n_f32(vdupq_n_f32(pl.w), x, pl.x) };
+            d = vfmaq_n_f32(d, y, pl.y);
+            d = vfmaq_n_f32(d, z, pl.z);
+            inside = vandq_u32(inside, vcgeq_f32(d, neg_r));
+        }
+
+        n += emit(vaddvq_u32(vandq_u32(inside, bits)), static_cast<uint32_t>(i), out + n);
+    }
+#else
+    for (std::size_t i{ begin }; i < end; ++i)
+    {
+        bool inside{ true };
+        for (auto const& pl : planes)
+        {
+            inside = inside && pl.x * xs[i] + pl.y * ys[i] + pl.z * zs[i] + pl.w >= -radii[i];
+        }
+        if (inside) out[n++] = static_cast<uint32_t>(i);
+    }
+#endif
+
+    return n;
+}
+
+} // namespace
+
+sphere_bounds::sphere_id
+sphere_bounds::add(glm::vec3 const& center, float radius)
+{
+    if (count == xs.size())
+    {
+        // padding has infinite negative radius, so it fails the first plane test
+        xs.resize(count + lanes, 0.0f);
+        ys.resize(count + lanes, 0.0f);
+        zs.resize(count + lanes, 0.0f);
+        radii.resize(count + lanes, -std::numeric_limits<float>::infinity());
+    }
+
+    auto const id = static_cast<sphere_id>(count++);
+    set(id, center, radius);
+
+    return id;
+}
+
+void
+sphere_bounds::set(sphere_id id, glm::vec3 const& center, float radius)
+{
+    assert(id < count);
+
+    xs[id] = center.x;
+    ys[id] = center.y;
+    zs[id] = center.z;
+    radii[id] = radius;
+}
+
+void
+sphere_bounds::clear()
+{
+    count = 0;
+    xs.clear();
+    ys.clear();
+    zs.clear();
+    radii.clear();
+}
+
+std::size_t
+sphere_bounds::size() const
+{
+    return count;
+}
+
+frustum
+frustum::from_matrix(glm::mat4 const& m)
+{
+    // Gribb/Hartmann, glm matrices are column-major so row `i` is `m[*][i]`
+    auto const row = [&m](int i) { return glm::vec4{ m[0][i], m[1][i], m[2][i], m[3][i] }; };
+
+    frustum res;
+    res.planes[to_underlying(plane::left)] = row(3) + row(0);
+    res.planes[to_underlying(plane::right)] = row(3) - row(0);
+    res.planes[to_underlying(plane::bottom)] = row(3) + row(1);
+    res.planes[to_underlying(plane::top)] = row(3) - row(1);
+    res.planes[to_underlying(plane::znear)] = row(3) + row(2);
+    res.planes[to_underlying(plane::zfar)] = row(3) - row(2);
+
+    for (auto& p : res.planes)
+    {
+        p /= glm::length(glm::vec3(p));
+    }
+
+    return res;
+}
+
+bool
+frustum::intersects_sphere(glm::vec3 const& center, float radius) const
+{
+    for (auto const& p : planes)
+    {
+        if (glm::dot(glm::vec3(p), center) + p.w < -radius) return false;
+    }
+
+    return true;
+}
+
+bool
+frustum::intersects_aabb(glm::vec3 const& min, glm::vec3 const& max) const
+{
+    for (auto const& p : planes)
+    {
+        // test the corner farthest along the plane normal
+        glm::vec3 const corner{ p.x >= 0 ? max.x : min.x, p.y >= 0 ? max.y : min.y,
+                                p.z >= 0 ? max.z : min.z };
+        if (glm::dot(glm::vec3(p), corner) + p.w < 0) return false;
+    }
+
+    return true;
+}
+
+void
+frustum::cull(sphere_bounds const& bounds, std::vector<uint32_t>& visible) const
+{
+    visible.resize(bounds.xs.size());
+    visible.resize(cull_range(planes, bounds.xs.data(), bounds.ys.data(), bounds.zs.data(),
+                              bounds.radii.data(), 0, bounds.xs.size(), visible.data()));
+}
+
+void
+frustum::cull(thread_pool& pool, sphere_bounds const& bounds, std::vector<uint32_t>& visible,
+              std::size_t min_chunk) const
+{
+    constexpr std::size_t lanes{ sphere_bounds::lanes };
+
+    // every chunk writes into its own range of `visible`, ranges are compacted afterwards
+    struct chunk
+    {
+        std::size_t begin{ 0 };
+        std::size_t count{ 0 };
+    };
+    // parallel_for never makes more chunks than threads
+    std::vector<chunk> chunks(pool.size() + 1);
+    std::atomic<std::size_t> next{ 0 };
+
+    visible.resize(bounds.xs.size());
+    pool.parallel_for(
+        bounds.xs.size() / lanes,
+        [&](std::size_t begin, std::size_t end)
+        {
+            std::size_t const count{ cull_range(planes, bounds.xs.data(), bounds.ys.data(),
+                                                bounds.zs.data(), bounds.radii.data(),
+                                                begin * lanes, end * lanes,
+                                                visible.data() + begin * lanes) };
+            chunks[next.fetch_add(1, std::memory_order_relaxed)] = { begin * lanes, count };
+        },
+        std::max<std::size_t>(min_chunk / lanes, 1));
+
+    // chunks finish in any order, ids must stay ascending
+    auto const done = std::span(chunks).first(next.load(std::memory_order_relaxed));
+    std::ranges::sort(done, {}, &chunk::begin);
+
+    std::size_t size{ 0 };
+    for (auto const& c : done)
+    {
+        // destination never starts after source, so forward copy is safe
+        auto const first = visible.begin() + static_cast<std::ptrdiff_t>(c.begin);
+        if (c.begin != size)
+        {
+            std::copy(first, first + static_cast<std::ptrdiff_t>(c.count),
+                      visible.begin() + static_cast<std::ptrdiff_t>(size));
+        }
+        size += c.count;
+    }
+    visible.resize(size);
+}
+
+} // namespace dg
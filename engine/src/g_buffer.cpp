@@ -0,0 +1,97 @@
+#include <engine/context.hpp>
+#include <engine/error.hpp>
+#include <engine/g_buffer.hpp>
+#include <engine/gl_state.hpp>
+#include <engine/pipeline_state.hpp>
+
+#include <glad/glad.h>
+
+namespace dg
+{
+
+namespace
+{
+
+///! single level target, read only with `texelFetch`, so filtering must not need mips
+texture
+create_target(context& ctx, texture::format_t format, glm::u32vec2 size)
+{
+    texture t(ctx, texture::target_t::texture_2d, format, size, 1);
+    // `texelFetch` of compared depth is undefined
+    if (format == texture::format_t::depth24) t.depth_compare(false);
+
+    return t;
+}
+
+} // namespace
+
+g_buffer::g_buffer(context& c, glm::u32vec2 size)
+    : ctx(c)
+    , extent(size)
+    , albedo_target(create_target(c, texture::format_t::rgba8, size))
+    , normal_target(create_target(c, texture::format_t::rg16ui, size))
+    , depth_target(create_target(c, texture::format_t::depth24, size))
+    , render_target(c)
+{
+    attach();
+}
+
+void
+g_buffer::resize(glm::u32vec2 size)
+{
+    if (size == extent) return;
+
+    extent = size;
+    albedo_target = create_target(ctx, texture::format_t::rgba8, extent);
+    normal_target = create_target(ctx, texture::format_t::rg16ui, extent);
+    depth_target = create_target(ctx, texture::format_t::depth24, extent);
+    attach();
+}
+
+void
+g_buffer::begin()
+{
+    prev_framebuffer = render_target.bind();
+
+    // previous frame isn't loaded, lighting skips pixels at far depth, so color needs no clear
+    render_target.invalidate();
+    ctx.state().depth_mask(true);
+    GLfloat const clear_depth{ 1.0f };
+    GL_CHECK(glClearBufferfv(GL_DEPTH, 0, &clear_depth));
+}
+
+void
+g_buffer::end()
+{
+    render_target.unbind(prev_framebuffer);
+}
+
+void
+g_buffer::resolve(pipeline_state const& lighting)
+{
+    albedo_target.bind_unit(albedo_unit);
+    normal_target.bind_unit(normal_unit);
+    depth_target.bind_unit(depth_unit);
+
+    lighting.apply();
+    GL_CHECK(glDrawArrays(GL_TRIANGLES, 0, 3));
+    ++ctx.frame_stats().draw_calls;
+}
+
+glm::u32vec2
+g_buffer::size() const
+{
+    return extent;
+}
+
+void
+g_buffer::attach()
+{
+    render_target.attach(albedo_target, 0, 0);
+    render_target.attach(normal_target, 0, 1);
+    render_target.attach(depth_target);
+    render_target.draw_buffers(2);
+    render_target.validate("g-buffer");
+}
+
+} // namespace dg
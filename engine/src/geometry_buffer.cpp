@@ -0,0 +1,92 @@
+#include <engine/context.hpp>
+#include <engine/geometry_buffer.hpp>
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <limits>
+
+namespace dg
+{
+
+geometry_buffer::geometry_buffer(context& ctx)
+    : array(ctx)
+{
+}
+
+geometry_buffer::mesh_id
+geometry_buffer::add(mesh const& m)
+{
+    uint32_t const stride{ 3 };
+    auto const base_vertex = static_cast<mesh::index_type>(staging.vertices.size() / stride);
+
+    range r{ .first_index = static_cast<uint32_t>(staging.indices.size()),
+             .index_count = static_cast<uint32_t>(m.indices.size()) };
+
+    glm::vec3 min{ std::numeric_limits<float>::max() };
+    glm::vec3 max{ std::numeric_limits<float>::lowest() };
+    for (std::size_t i{ 0 }; i + 2 < m.vertices.size(); i += stride)
+    {
+        glm::vec3 const p{ m.vertices[i], m.vertices[i + 1], m.vertices[i + 2] };
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    glm::vec3 const center = m.vertices.empty() ? glm::vec3{ 0 } : (min + max) * 0.5f;
+    float radius{ 0 };
+    for (std::size_t i{ 0 }; i + 2 < m.vertices.size(); i += stride)
+    {
+        glm::vec3 const p{ m.vertices[i], m.vertices[i + 1], m.vertices[i + 2] };
+        radius = std::max(radius, glm::length(p - center));
+    }
+    r.bounds = glm::vec4{ center, radius };
+
+    staging.vertices.insert(staging.vertices.end(), m.vertices.begin(), m.vertices.end());
+
+    // meshes without normals still have to keep attributes aligned with positions
+    staging.normals.insert(staging.normals.end(), m.normals.begin(), m.normals.end());
+    staging.normals.resize(staging.vertices.size(), 0);
+
+    // indices are rebased here, so draws don't depend on base vertex support
+    std::ranges::transform(m.indices, std::back_inserter(staging.indices),
+                           [base_vertex](mesh::index_type i) { return i + base_vertex; });
+
+    ranges.push_back(r);
+
+    return static_cast<mesh_id>(ranges.size() - 1);
+}
+
+void
+geometry_buffer::upload(vertex_array::data_t type)
+{
+    array.load(0, type, staging.vertices);
+    array.load(1, type, staging.normals);
+    array.load_indices(type, staging.indices);
+
+    staging = mesh{};
+}
+
+geometry_buffer::range const&
+geometry_buffer::at(mesh_id id) const
+{
+    assert(id < ranges.size());
+
+    return ranges[id];
+}
+
+std::size_t
+geometry_buffer::size() const
+{
+    return ranges.size();
+}
+
+vertex_array&
+geometry_buffer::vao()
+{
+    return array;
+}
+
+} // namespace dg
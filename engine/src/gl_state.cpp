@@ -0,0 +1,415 @@
+#include <engine/error.hpp>
+#include <engine/gl_state.hpp>
+#include <engine/util.hpp>
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace dg
+{
+
+namespace
+{
+
+GLenum
+gl_buffer_target(buffer::target_t target)
+{
+    switch (target)
+    {
+    case buffer::target_t::array:
+        return GL_ARRAY_BUFFER;
+    case buffer::target_t::element_array:
+        return GL_ELEMENT_ARRAY_BUFFER;
+    case buffer::target_t::uniform:
+        return GL_UNIFORM_BUFFER;
+    case buffer::target_t::shader_storage:
+        return GL_SHADER_STORAGE_BUFFER;
+    case buffer::target_t::draw_indirect:
+        return GL_DRAW_INDIRECT_BUFFER;
+    case buffer::target_t::pixel_pack:
+        return GL_PIXEL_PACK_BUFFER;
+    }
+
+    unreachable();
+}
+
+GLenum
+gl_texture_target(texture::target_t target)
+{
+    switch (target)
+    {
+    case texture::target_t::texture_2d:
+        return GL_TEXTURE_2D;
+    case texture::target_t::texture_2d_array:
+        return GL_TEXTURE_2D_ARRAY;
+    case texture::target_t::texture_cube_map:
+        return GL_TEXTURE_CUBE_MAP;
+    }
+
+    unreachable();
+}
+
+GLenum
+gl_capability(context::capability cap)
+{
+    switch (cap)
+    {
+    case context::capability::depth_test:
+        return GL_DEPTH_TEST;
+    case context::capability::blend:
+        return GL_BLEND;
+    case context::capability::cull_face:
+        return GL_CULL_FACE;
+    case context::capability::scissor_test:
+        return GL_SCISSOR_TEST;
+    case context::capability::stencil_test:
+        return GL_STENCIL_TEST;
+    case context::capability::polygon_offset_fill:
+        return GL_POLYGON_OFFSET_FILL;
+    }
+
+    unreachable();
+}
+
+GLenum
+gl_compare(pipeline_state::compare_t func)
+{
+    switch (func)
+    {
+    case pipeline_state::compare_t::never:
+        return GL_NEVER;
+    case pipeline_state::compare_t::less:
+        return GL_LESS;
+    case pipeline_state::compare_t::equal:
+        return GL_EQUAL;
+    case pipeline_state::compare_t::less_equal:
+        return GL_LEQUAL;
+    case pipeline_state::compare_t::greater:
+        return GL_GREATER;
+    case pipeline_state::compare_t::not_equal:
+        return GL_NOTEQUAL;
+    case pipeline_state::compare_t::greater_equal:
+        return GL_GEQUAL;
+    case pipeline_state::compare_t::always:
+        return GL_ALWAYS;
+    }
+
+    unreachable();
+}
+
+GLenum
+gl_blend_factor(pipeline_state::blend_factor_t factor)
+{
+    switch (factor)
+    {
+    case pipeline_state::blend_factor_t::zero:
+        return GL_ZERO;
+    case pipeline_state::blend_factor_t::one:
+        return GL_ONE;
+    case pipeline_state::blend_factor_t::src_alpha:
+        return GL_SRC_ALPHA;
+    case pipeline_state::blend_factor_t::one_minus_src_alpha:
+        return GL_ONE_MINUS_SRC_ALPHA;
+    case pipeline_state::blend_factor_t::dst_alpha:
+        return GL_DST_ALPHA;
+    case pipeline_state::blend_factor_t::one_minus_dst_alpha:
+        return GL_ONE_MINUS_DST_ALPHA;
+    }
+
+    unreachable();
+}
+
+GLenum
+gl_face(pipeline_state::face_t face)
+{
+    switch (face)
+    {
+    case pipeline_state::face_t::front:
+        return GL_FRONT;
+    case pipeline_state::face_t::back:
+        return GL_BACK;
+    case pipeline_state::face_t::front_and_back:
+        return GL_FRONT_AND_BACK;
+    }
+
+    unreachable();
+}
+
+std::size_t
+indexed_slot(buffer::target_t target)
+{
+    assert(target == buffer::target_t::uniform || target == buffer::target_t::shader_storage);
+
+    return target == buffer::target_t::uniform ? 0 : 1;
+}
+
+} // namespace
+
+gl_state::gl_state(context::stats_t& s)
+    : stats(s)
+{
+}
+
+bool
+gl_state::is_redundant(bool equal)
+{
+    ++(equal ? stats.elided_state_changes : stats.state_changes);
+
+    return equal;
+}
+
+gl_state::handle_t
+gl_state::use_program(handle_t program)
+{
+    handle_t const prev{ current_program };
+    if (program == unknown || is_redundant(program == current_program)) return prev;
+
+    GL_CHECK(glUseProgram(program));
+    current_program = program;
+
+    return prev;
+}
+
+gl_state::handle_t
+gl_state::bind_vertex_array(handle_t vao)
+{
+    handle_t const prev{ current_vertex_array };
+    if (vao == unknown || is_redundant(vao == current_vertex_array)) return prev;
+
+    GL_CHECK(glBindVertexArray(vao));
+    current_vertex_array = vao;
+    // element array binding is part of vertex array state
+    buffers[to_underlying(buffer::target_t::element_array)] = unknown;
+
+    return prev;
+}
+
+gl_state::handle_t
+gl_state::bind_buffer(buffer::target_t target, handle_t buf)
+{
+    auto& current = buffers[to_underlying(target)];
+    handle_t const prev{ current };
+    if (buf == unknown || is_redundant(buf == current)) return prev;
+
+    GL_CHECK(glBindBuffer(gl_buffer_target(target), buf));
+    current = buf;
+
+    return prev;
+}
+
+void
+gl_state::bind_buffer_base(buffer::target_t target, uint32_t index, handle_t buf)
+{
+    assert(index < max_buffer_bindings);
+
+    auto& current = indexed_buffers[indexed_slot(target)][index];
+    if (is_redundant(buf == current && buf == buffers[to_underlying(target)])) return;
+
+    GL_CHECK(glBindBufferBase(gl_buffer_target(target), index, buf));
+    current = buf;
+    buffers[to_underlying(target)] = buf;
+}
+
+gl_state::handle_t
+gl_state::bind_framebuffer(handle_t fbo)
+{
+    handle_t const prev{ current_framebuffer };
+    if (fbo == unknown || is_redundant(fbo == current_framebuffer)) return prev;
+
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+    current_framebuffer = fbo;
+
+    return prev;
+}
+
+void
+gl_state::active_texture(uint32_t unit)
+{
+    assert(unit < max_texture_units);
+
+    if (is_redundant(unit == active_unit)) return;
+
+    GL_CHECK(glActiveTexture(GL_TEXTURE0 + unit));
+    active_unit = unit;
+}
+
+gl_state::handle_t
+gl_state::bind_texture(uint32_t unit, texture::target_t target, handle_t tex)
+{
+    assert(unit < max_texture_units);
+
+    auto& current = textures[unit][to_underlying(target)];
+    handle_t const prev{ current };
+    if (tex == unknown || is_redundant(tex == current)) return prev;
+
+    active_texture(unit);
+    GL_CHECK(glBindTexture(gl_texture_target(target), tex));
+    current = tex;
+
+    return prev;
+}
+
+bool
+gl_state::enable(context::capability cap, bool enable)
+{
+    uint32_t const bit{ 1u << to_underlying(cap) };
+    bool const prev{ (capabilities & bit) != 0 };
+    if (is_redundant((unknown_capabilities & bit) == 0 && prev == enable)) return prev;
+
+    if (enable)
+    {
+        GL_CHECK(glEnable(gl_capability(cap)));
+        capabilities |= bit;
+    } else
+    {
+        GL_CHECK(glDisable(gl_capability(cap)));
+        capabilities &= ~bit;
+    }
+    unknown_capabilities &= ~bit;
+
+    return prev;
+}
+
+void
+gl_state::depth_mask(bool write)
+{
+    uint32_t const value{ write ? 1u : 0u };
+    if (is_redundant(value == depth_write)) return;
+
+    GL_CHECK(glDepthMask(write ? GL_TRUE : GL_FALSE));
+    depth_write = value;
+}
+
+void
+gl_state::depth_func(pipeline_state::compare_t func)
+{
+    if (is_redundant(to_underlying(func) == depth_function)) return;
+
+    GL_CHECK(glDepthFunc(gl_compare(func)));
+    depth_function = to_underlying(func);
+}
+
+void
+gl_state::blend_func(pipeline_state::blend_factor_t src, pipeline_state::blend_factor_t dst)
+{
+    if (is_redundant(to_underlying(src) == blend_src && to_underlying(dst) == blend_dst)) return;
+
+    GL_CHECK(glBlendFunc(gl_blend_factor(src), gl_blend_factor(dst)));
+    blend_src = to_underlying(src);
+    blend_dst = to_underlying(dst);
+}
+
+void
+gl_state::cull_face(pipeline_state::face_t face)
+{
+    if (is_redundant(to_underlying(face) == culled_face)) return;
+
+    GL_CHECK(glCullFace(gl_face(face)));
+    culled_face = to_underlying(face);
+}
+
+gl_state::handle_t
+gl_state::bound_program() const
+{
+    return current_program;
+}
+
+gl_state::handle_t
+gl_state::bound_vertex_array() const
+{
+    return current_vertex_array;
+}
+
+gl_state::handle_t
+gl_state::bound_framebuffer() const
+{
+    return current_framebuffer;
+}
+
+gl_state::handle_t
+gl_state::bound_buffer(buffer::target_t target) const
+{
+    return buffers[to_underlying(target)];
+}
+
+gl_state::handle_t
+gl_state::bound_texture(uint32_t unit, texture::target_t target) const
+{
+    assert(unit < max_texture_units);
+
+    return textures[unit][to_underlying(target)];
+}
+
+uint32_t
+gl_state::active_texture_unit() const
+{
+    return active_unit;
+}
+
+bool
+gl_state::is_enabled(context::capability cap) const
+{
+    return (capabilities & (1u << to_underlying(cap))) != 0;
+}
+
+void
+gl_state::forget(deletion_queue::object_t type, std::span<handle_t const> handles)
+{
+    auto const reset = [&handles](handle_t& h, handle_t value)
+    {
+        if (std::ranges::find(handles, h) != handles.end()) h = value;
+    };
+
+    switch (type)
+    {
+    case deletion_queue::object_t::program:
+        // deleted program stays in use until another one is bound
+        reset(current_program, unknown);
+        return;
+    case deletion_queue::object_t::vertex_array:
+        reset(current_vertex_array, 0);
+        return;
+    case deletion_queue::object_t::buffer:
+        for (auto& b : buffers) reset(b, 0);
+        for (auto& bindings : indexed_buffers)
+        {
+            for (auto& b : bindings) reset(b, 0);
+        }
+        return;
+    case deletion_queue::object_t::texture:
+        for (auto& unit : textures)
+        {
+            for (auto& t : unit) reset(t, 0);
+        }
+        return;
+    case deletion_queue::object_t::framebuffer:
+        reset(current_framebuffer, 0);
+        return;
+    default:
+        return;
+    }
+}
+
+void
+gl_state::invalidate()
+{
+    current_program = unknown;
+    current_vertex_array = unknown;
+    current_framebuffer = unknown;
+    buffers.fill(unknown);
+    for (auto& bindings : indexed_buffers) bindings.fill(unknown);
+    for (auto& unit : textures) unit.fill(unknown);
+    // there is no unknown texture unit, so make shadow match GL
+    GL_CHECK(glActiveTexture(GL_TEXTURE0));
+    active_unit = 0;
+    unknown_capabilities = ~uint32_t{ 0 };
+    depth_write = unknown;
+    depth_function = unknown;
+    blend_src = unknown;
+    blend_dst = unknown;
+    culled_face = unknown;
+}
+
+} // namespace dg
@@ -0,0 +1,244 @@
+#include <engine/bind_guard.hpp>
+#include <engine/error.hpp>
+#include <engine/frustum.hpp>
+#include <engine/gpu_scene.hpp>
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <span>
+
+namespace dg
+{
+
+namespace
+{
+
+constexpr uint32_t culling_group_size{ 64 };
+
+// bindings: 0 - objects, 1 - draw commands, 2 - visible object ids, 3 - per-mesh offsets into visible ids
+constexpr std::string_view culling_shader_src = R"(
+#version 310 es
+
+layout (local_size_x = 64) in;
+
+struct object
+{
+    mat4 model;
+    vec4 bounds;
+    uvec4 mesh;
+};
+
+struct draw_command
+{
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint reserved;
+};
+
+layout (std430, binding = 0) readonly buffer objects_block { object objects[]; };
+layout (std430, binding = 1) buffer commands_block { draw_command commands[]; };
+layout (std430, binding = 2) writeonly buffer visible_block { uint visible[]; };
+layout (std430, binding = 3) readonly buffer offsets_block { uint offsets[]; };
+
+layout (location = 0) uniform vec4 planes[6];
+layout (location = 6) uniform uint object_count;
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= object_count) return;
+
+    mat4 model = objects[id].model;
+    vec4 bounds = objects[id].bounds;
+
+    vec3 center = (model * vec4(bounds.xyz, 1.0f)).xyz;
+    float scale = sqrt(max(max(dot(model[0].xyz, model[0].xyz), dot(model[1].xyz, model[1].xyz)),
+                           dot(model[2].xyz, model[2].xyz)));
+    float radius = bounds.w * scale;
+
+    for (int i = 0; i < 6; ++i)
+    {
+        if (dot(planes[i].xyz, center) + planes[i].w < -radius) return;
+    }
+
+    uint mesh = objects[id].mesh.x;
+    uint slot = atomicAdd(commands[mesh].instance_count, 1u);
+    visible[offsets[mesh] + slot] = id;
+}
+)";
+
+} // namespace
+
+gpu_scene::error::error(std::string const& msg)
+    : std::runtime_error(msg)
+{
+}
+
+gpu_scene::error::error(char const* msg)
+    : std::runtime_error(msg)
+{
+}
+
+gpu_scene::gpu_scene(context& ctx, geometry_buffer& g)
+    : geometry(g)
+    , culling_program(ctx)
+    , objects_buffer(ctx, buffer::target_t::shader_storage)
+    , commands_buffer(ctx, buffer::target_t::draw_indirect)
+    , visible_buffer(ctx, buffer::target_t::shader_storage)
+    , offsets_buffer(ctx, buffer::target_t::shader_storage)
+{
+    // GLES 3.1 allows zero storage blocks in vertex shader, but `glsl_declarations` needs two
+    GLint max_vertex_blocks{ 0 };
+    GL_CHECK(glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &max_vertex_blocks));
+    if (max_vertex_blocks < 2)
+    {
+        throw error(std::format("vertex shader storage blocks aren't supported enough: {}",
+                                max_vertex_blocks));
+    }
+
+    culling_program.attach_from_src(shader_program::shader_t::compute, culling_shader_src);
+    try
+    {
+        culling_program.link();
+    } catch (shader_program::error const& e)
+    {
+        throw error(std::format("error occurs linking culling program: {}", e.what()));
+    }
+}
+
+gpu_scene::object_id
+gpu_scene::add(geometry_buffer::mesh_id mesh, glm::mat4 const& model)
+{
+    objects.push_back(object{ .model = model,
+                              .bounds = geometry.at(mesh).bounds,
+                              .mesh = glm::u32vec4{ mesh, 0, 0, 0 } });
+    is_layout_dirty = true;
+
+    return static_cast<object_id>(objects.size() - 1);
+}
+
+void
+gpu_scene::transform(object_id id, glm::mat4 const& model)
+{
+    assert(id < objects.size());
+
+    objects[id].model = model;
+
+    if (dirty_begin == dirty_end)
+    {
+        dirty_begin = id;
+        dirty_end = id + 1;
+    } else
+    {
+        dirty_begin = std::min<std::size_t>(dirty_begin, id);
+        dirty_end = std::max<std::size_t>(dirty_end, id + 1);
+    }
+}
+
+void
+gpu_scene::rebuild_layout()
+{
+    std::size_t const mesh_count{ geometry.size() };
+
+    counts.assign(mesh_count, 0);
+    for (auto const& o : objects)
+    {
+        ++counts[o.mesh.x];
+    }
+
+    offsets.assign(mesh_count, 0);
+    commands.assign(mesh_count, draw_command{});
+    uint32_t offset{ 0 };
+    for (std::size_t i{ 0 }; i < mesh_count; ++i)
+    {
+        offsets[i] = offset;
+        offset += counts[i];
+
+        auto const& r = geometry.at(static_cast<geometry_buffer::mesh_id>(i));
+        commands[i].count = r.index_count;
+        commands[i].first_index = r.first_index;
+    }
+
+    objects_buffer.load(buffer::data_t::dynamic, std::span(objects));
+    visible_buffer.load(buffer::data_t::dynamic, {}, objects.size() * sizeof(uint32_t));
+    offsets_buffer.load(buffer::data_t::immutable, std::span(offsets));
+    commands_buffer.load(buffer::data_t::dynamic, std::span(commands));
+
+    is_layout_dirty = false;
+    dirty_begin = dirty_end = 0;
+}
+
+void
+gpu_scene::cull(glm::mat4 const& view_proj)
+{
+    if (objects.empty()) return;
+
+    if (is_layout_dirty)
+    {
+        rebuild_layout();
+    } else
+    {
+        if (dirty_begin != dirty_end)
+        {
+            objects_buffer.update(dirty_begin * sizeof(object),
+                                  std::span(objects).subspan(dirty_begin, dirty_end - dirty_begin));
+            dirty_begin = dirty_end = 0;
+        }
+
+        // resets instance counters written by previous culling
+        commands_buffer.update(0, std::span(commands));
+    }
+
+    auto const f = frustum::from_matrix(view_proj);
+    for (std::size_t i{ 0 }; i < f.planes.size(); ++i)
+    {
+        culling_program.uniform(static_cast<shader_program::uniform_location>(i), f.planes[i]);
+    }
+    culling_program.uniform(6, static_cast<uint32_t>(objects.size()));
+
+    objects_buffer.bind_base(0);
+    commands_buffer.bind_base(buffer::target_t::shader_storage, 1);
+    visible_buffer.bind_base(2);
+    offsets_buffer.bind_base(3);
+
+    auto const groups = static_cast<uint32_t>((objects.size() + culling_group_size - 1) / culling_group_size);
+    culling_program.dispatch({ groups, 1, 1 });
+
+    GL_CHECK(glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT));
+}
+
+void
+gpu_scene::draw(shader_program& program)
+{
+    if (objects.empty() || is_layout_dirty) return;
+
+    objects_buffer.bind_base(0);
+    visible_buffer.bind_base(2);
+
+    bind_guard _1{ program };
+    bind_guard _2{ geometry.vao() };
+    bind_guard _3{ commands_buffer };
+
+    for (std::size_t i{ 0 }; i < commands.size(); ++i)
+    {
+        if (counts[i] == 0) continue;
+
+        program.uniform(instance_offset_location, offsets[i]);
+
+        auto const* const indirect = reinterpret_cast<void const*>(i * sizeof(draw_command));
+        GL_CHECK(glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, indirect));
+    }
+}
+
+std::size_t
+gpu_scene::size() const
+{
+    return objects.size();
+}
+
+} // namespace dg
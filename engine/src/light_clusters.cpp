@@ -0,0 +1,358 @@
+#include <engine/context.hpp>
+#include <engine/error.hpp>
+#include <engine/light_clusters.hpp>
+#include <engine/thread_pool.hpp>
+
+#include <glad/glad.h>
+
+#include <glm/matrix.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <format>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define DG_CLUSTERS_SSE 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define DG_CLUSTERS_NEON 1
+#endif
+
+namespace dg
+{
+
+namespace
+{
+
+// slices keep lights in SIMD registers of this many lanes
+constexpr std::size_t lanes{ 4 };
+
+// padding lights are so far that squared distance to any froxel overflows to infinity
+constexpr float far_away{ std::numeric_limits<float>::max() };
+
+///! appends `ids[base + i]` for every set bit `i` of `mask`
+void
+emit(uint32_t mask, std::size_t base, uint32_t const* ids, std::vector<uint32_t>& out)
+{
+    for (; mask != 0; mask &= mask - 1)
+    {
+        out.push_back(ids[base + static_cast<std::size_t>(std::countr_zero(mask))]);
+    }
+}
+
+///! appends ids of spheres overlapping `box`, `count` is multiple of lanes. Sphere overlaps box
+///! when squared distance from its center to the box is at most squared radius
+void
+overlapping(aabb const& box, float const* xs, float const* ys, float const* zs,
+            float const* radii, uint32_t const* ids, std::size_t count, std::vector<uint32_t>& out)
+{
+    assert(count % lanes == 0);
+
+#if defined(DG_CLUSTERS_SSE)
+    __m128 const min_x{ _mm_set1_ps(box.min.x) };
+    __m128 const min_y{ _mm_set1_ps(box.min.y) };
+    __m128 const min_z{ _mm_set1_ps(box.min.z) };
+    __m128 const max_x{ _mm_set1_ps(box.max.x) };
+    __m128 const max_y{ _mm_set1_ps(box.max.y) };
+    __m128 const max_z{ _mm_set1_ps(box.max.z) };
+    __m128 const zero{ _mm_setzero_ps() };
+
+    for (std::size_t i{ 0 }; i < count; i += lanes)
+    {
+        __m128 const x{ _mm_loadu_ps(xs + i) };
+        __m128 const y{ _mm_loadu_ps(ys + i) };
+        __m128 const z{ _mm_loadu_ps(zs + i) };
+        __m128 const r{ _mm_loadu_ps(radii + i) };
+
+        // distance to the box along each axis, 0 inside of it
+        __m128 const dx{ _mm_max_ps(_mm_max_ps(_mm_sub_ps(min_x, x), _mm_sub_ps(x, max_x)),
+                                    zero) };
+        __m128 const dy{ _mm_max_ps(_mm_max_ps(_mm_sub_ps(min_y, y), _mm_sub_ps(y, max_y)),
+                                    zero) };
+        __m128 const dz{ _mm_max_ps(_mm_max_ps(_mm_sub_ps(min_z, z), _mm_sub_ps(z, max_z)),
+                                    zero) };
+        __m128 const d2{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                                    _mm_mul_ps(dz, dz)) };
+
+        __m128 const is_overlapping{ _mm_cmple_ps(d2, _mm_mul_ps(r, r)) };
+        emit(static_cast<uint32_t>(_mm_movemask_ps(is_overlapping)), i, ids, out);
+    }
+#elif defined(DG_CLUSTERS_NEON)
+    uint32x4_t const bits{ 1, 2, 4, 8 };
+    float32x4_t const zero{ vdupq_n_f32(0.0f) };
+
+    for (std::size_t i{ 0 }; i < count; i += lanes)
+    {
+        float32x4_t const x{ vld1q_f32(xs + i) };
+        float32x4_t const y{ vld1q_f32(ys + i) };
+        float32x4_t const z{ vld1q_f32(zs + i) };
+        float32x4_t const r{ vld1q_f32(radii + i) };
+
+        float32x4_t const dx{ vmaxq_f32(
+            vmaxq_f32(vsubq_f32(vdupq_n_f32(box.min.x), x), vsubq_f32(x, vdupq_n_f32(box.max.x))),
+            zero) };
+        float32x4_t const dy{ vmaxq_f32(
+            vmaxq_f32(vsubq_f32(vdupq_n_f32(box.min.y), y), vsubq_f32(y, vdupq_n_f32(box.max.y))),
+            zero) };
+        float32x4_t const dz{ vmaxq_f32(
+            vmaxq_f32(vsubq_f32(vdupq_n_f32(box.min.z), z), vsubq_f32(z, vdupq_n_f32(box.max.z))),
+            zero) };
+        float32x4_t d2{ vmulq_f32(dx, dx) };
+        d2 = vfmaq_f32(d2, dy, dy);
+        d2 = vfmaq_f32(d2, dz, dz);
+
+        emit(vaddvq_u32(vandq_u32(vcleq_f32(d2, vmulq_f32(r, r)), bits)), i, ids, out);
+    }
+#else
+    for (std::size_t i{ 0 }; i < count; ++i)
+    {
+        float const dx{ std::max({ box.min.x - xs[i], xs[i] - box.max.x, 0.0f }) };
+        float const dy{ std::max({ box.min.y - ys[i], ys[i] - box.max.y, 0.0f }) };
+        float const dz{ std::max({ box.min.z - zs[i], zs[i] - box.max.z, 0.0f }) };
+        if (dx * dx + dy * dy + dz * dz <= radii[i] * radii[i]) out.push_back(ids[i]);
+    }
+#endif
+}
+
+} // namespace
+
+void
+cluster_grid::update(glm::mat4 const& p)
+{
+    if (p == projection && !boxes.empty()) return;
+
+    projection = p;
+    z_near = p[3][2] / (p[2][2] - 1.0f);
+    z_far = p[3][2] / (p[2][2] + 1.0f);
+    assert(z_near > 0.0f && z_far > z_near);
+
+    // directions through tile corners, scaled so that view depth is 1
+    glm::mat4 const inv_projection{ glm::inverse(p) };
+    std::vector<glm::vec3> corners;
+    corners.reserve(std::size_t{ tiles_x + 1 } * (tiles_y + 1));
+    for (uint32_t y{ 0 }; y <= tiles_y; ++y)
+    {
+        for (uint32_t x{ 0 }; x <= tiles_x; ++x)
+        {
+            glm::vec4 const ndc{ 2.0f * static_cast<float>(x) / tiles_x - 1.0f,
+                                 2.0f * static_cast<float>(y) / tiles_y - 1.0f, -1.0f, 1.0f };
+            glm::vec4 const on_near{ inv_projection * ndc };
+            glm::vec3 const v{ glm::vec3(on_near) / on_near.w };
+            corners.push_back(v / -v.z);
+        }
+    }
+
+    boxes.resize(count);
+    for (uint32_t z{ 0 }; z < slices; ++z)
+    {
+        float const depths[2]{ slice_depth(z), slice_depth(z + 1) };
+        for (uint32_t y{ 0 }; y < tiles_y; ++y)
+        {
+            for (uint32_t x{ 0 }; x < tiles_x; ++x)
+            {
+                aabb box;
+                for (uint32_t c{ 0 }; c < 4; ++c)
+                {
+                    uint32_t const corner{ (y + (c >> 1)) * (tiles_x + 1) + x + (c & 1) };
+                    for (float const d : depths) box.grow(corners[corner] * d);
+                }
+                boxes[index(x, y, z)] = box;
+            }
+        }
+    }
+}
+
+void
+cluster_grid::bin(thread_pool& pool, glm::mat4 const& view, std::span<point_light const> lights)
+{
+    assert(!boxes.empty());
+
+    view_lights.resize(lights.size());
+    for (std::size_t i{ 0 }; i < lights.size(); ++i)
+    {
+        view_lights[i] = { glm::vec3(view * glm::vec4{ lights[i].position, 1.0f }),
+                           lights[i].radius };
+    }
+    slice_lights.resize(slices);
+    ranges.resize(count);
+
+    // froxels of a slice are written only by its job
+    pool.parallel_for(
+        slices,
+        [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t z{ begin }; z < end; ++z) bin_slice(static_cast<uint32_t>(z));
+        },
+        1);
+
+    indices.clear();
+    for (uint32_t z{ 0 }; z < slices; ++z)
+    {
+        auto const& slice_indices = slice_lights[z].indices;
+        auto const base{ static_cast<uint32_t>(indices.size()) };
+        indices.insert(indices.end(), slice_indices.begin(), slice_indices.end());
+        for (uint32_t c{ index(0, 0, z) }; c < index(0, 0, z + 1); ++c) ranges[c].x += base;
+    }
+}
+
+void
+cluster_grid::bin_slice(uint32_t z)
+{
+    slice& s = slice_lights[z];
+    s.xs.clear();
+    s.ys.clear();
+    s.zs.clear();
+    s.radii.clear();
+    s.ids.clear();
+    s.indices.clear();
+
+    // lights reaching depth range of the slice are candidates for its froxels
+    float const near_depth{ slice_depth(z) };
+    float const far_depth{ slice_depth(z + 1) };
+    for (std::size_t i{ 0 }; i < view_lights.size(); ++i)
+    {
+        glm::vec4 const& l = view_lights[i];
+        if (-l.z + l.w < near_depth || -l.z - l.w > far_depth) continue;
+
+        s.xs.push_back(l.x);
+        s.ys.push_back(l.y);
+        s.zs.push_back(l.z);
+        s.radii.push_back(l.w);
+        s.ids.push_back(static_cast<uint32_t>(i));
+    }
+    while (s.ids.size() % lanes != 0)
+    {
+        s.xs.push_back(far_away);
+        s.ys.push_back(far_away);
+        s.zs.push_back(far_away);
+        s.radii.push_back(0.0f);
+        s.ids.push_back(0);
+    }
+
+    for (uint32_t y{ 0 }; y < tiles_y; ++y)
+    {
+        for (uint32_t x{ 0 }; x < tiles_x; ++x)
+        {
+            uint32_t const c{ index(x, y, z) };
+            auto const offset{ static_cast<uint32_t>(s.indices.size()) };
+            overlapping(boxes[c], s.xs.data(), s.ys.data(), s.zs.data(), s.radii.data(),
+                        s.ids.data(), s.ids.size(), s.indices);
+            ranges[c] = { offset, static_cast<uint32_t>(s.indices.size()) - offset };
+        }
+    }
+}
+
+float
+cluster_grid::slice_depth(uint32_t z) const
+{
+    return z_near * std::pow(z_far / z_near, static_cast<float>(z) / slices);
+}
+
+std::span<glm::u32vec2 const>
+cluster_grid::clusters() const
+{
+    return ranges;
+}
+
+std::span<uint32_t const>
+cluster_grid::light_indices() const
+{
+    return indices;
+}
+
+aabb const&
+cluster_grid::bounds(uint32_t cluster) const
+{
+    return boxes[cluster];
+}
+
+float
+cluster_grid::near_plane() const
+{
+    return z_near;
+}
+
+float
+cluster_grid::far_plane() const
+{
+    return z_far;
+}
+
+glm::vec2
+cluster_grid::slice_scale_bias() const
+{
+    float const log_ratio{ std::log(z_far / z_near) };
+
+    return { slices / log_ratio, -static_cast<float>(slices) * std::log(z_near) / log_ratio };
+}
+
+DG_STD140_MEMBER(light_clusters::params, size);
+DG_STD140_MEMBER(light_clusters::params, viewport);
+DG_STD140_MEMBER(light_clusters::params, slice_scale_bias);
+
+light_clusters::error::error(std::string const& msg)
+    : std::runtime_error(msg)
+{
+}
+
+light_clusters::error::error(char const* msg)
+    : std::runtime_error(msg)
+{
+}
+
+light_clusters::light_clusters(context& ctx)
+    : params_block(ctx, params_binding)
+    , lights_buffer(ctx, buffer::target_t::shader_storage)
+    , clusters_buffer(ctx, buffer::target_t::shader_storage)
+    , light_indices_buffer(ctx, buffer::target_t::shader_storage)
+{
+    // GLES 3.1 allows zero storage blocks in fragment shader, but `glsl_declarations` needs three
+    GLint max_fragment_blocks{ 0 };
+    GL_CHECK(glGetIntegerv(GL_MAX_FRAGMENT_SHADER_STORAGE_BLOCKS, &max_fragment_blocks));
+    if (max_fragment_blocks < 3)
+    {
+        throw error(std::format("fragment shader storage blocks aren't supported enough: {}",
+                                max_fragment_blocks));
+    }
+}
+
+void
+light_clusters::update(thread_pool& pool, glm::mat4 const& projection, glm::mat4 const& view,
+                       glm::u32vec2 viewport, std::span<point_light const> lights)
+{
+    clusters.update(projection);
+    clusters.bin(pool, view, lights);
+
+    params_block.update({ .size = glm::u32vec4{ cluster_grid::tiles_x, cluster_grid::tiles_y,
+                                                 cluster_grid::slices, 0 },
+                          .viewport = glm::vec2(viewport),
+                          .slice_scale_bias = clusters.slice_scale_bias() });
+
+    // buffers are orphaned every frame, empty ones still get storage to be bindable
+    auto const upload = [](buffer& b, uint32_t binding, auto data)
+    {
+        if (data.empty())
+        {
+            b.load(buffer::data_t::stream, {}, sizeof(glm::vec4));
+        } else
+        {
+            b.load(buffer::data_t::stream, data);
+        }
+        b.bind_base(binding);
+    };
+    upload(lights_buffer, lights_binding, lights);
+    upload(clusters_buffer, clusters_binding, clusters.clusters());
+    upload(light_indices_buffer, light_indices_binding, clusters.light_indices());
+}
+
+cluster_grid const&
+light_clusters::grid() const
+{
+    return clusters;
+}
+
+} // namespace dg
@@ -3,8 +3,6 @@
 #include <engine/mesh_loader.hpp>
 #include <engine/util.hpp>
 
-#include <SDL3/SDL_iostream.h>
-
 #include "engine/vertex_array.hpp"
 
 #include <filesystem>
@@ -22,70 +20,22 @@ namespace
 
 // WARNING: this mess.. khm code* writen by chat gpt. Absolutely not by me
 
-std::vector<std::byte>
-load_file(std::filesystem::path const& filename)
-{
-    SDL_IOStream* const io = SDL_IOFromFile(filename.string().c_str(), "r");
-    if (nullptr == io)
-    {
-        LOG_DEBUG("error occured openning file: %s", SDL_GetError());
-        return {};
-    }
-
-    SDL_SeekIO(io, 0, SDL_IO_SEEK_END);
-    size_t const filesize{ static_cast<size_t>(SDL_TellIO(io)) };
-    SDL_SeekIO(io, 0, SDL_IO_SEEK_SET);
-
-    std::vector<std::byte> buf;
-    buf.resize(filesize);
-    if (0 == SDL_ReadIO(io, buf.data(), filesize))
-    {
-        LOG_DEBUG("error occurs reading SDL_IOStream: %s", SDL_GetError());
-    }
-
-    if (0 != SDL_CloseIO(io))
-    {
-        LOG_DEBUG("error occurs closing SDL_IOStream: %s", SDL_GetError());
-    }
-
-    return buf;
-}
-
 std::optional<mesh>
 load_obj(std::filesystem::path const& filename)
 {
     mesh res;
 
-    // TODO: extract loading file into memory to separate function
-    std::stringstream file;
+    auto const data{ load_file(filename) };
+    if (data.empty())
     {
-        SDL_IOStream* const io = SDL_IOFromFile(filename.string().c_str(), "r");
-        if (nullptr == io)
-        {
-            LOG_DEBUG("error occured openning file: %s", SDL_GetError());
-            return std::nullopt;
-        }
-
-        SDL_SeekIO(io, 0, SDL_IO_SEEK_END);
-        size_t const filesize{ static_cast<size_t>(SDL_TellIO(io)) };
-        SDL_SeekIO(io, 0, SDL_IO_SEEK_SET);
-
-        std::string buf;
-        buf.resize(filesize);
-        if (0 == SDL_ReadIO(io, buf.data(), filesize))
-        {
-            LOG_DEBUG("error occurs reading SDL_IOStream: %s", SDL_GetError());
-        }
-
-        file << buf;
-
-        if (0 != SDL_CloseIO(io))
-        {
-            LOG_DEBUG("error occurs closing SDL_IOStream: %s", SDL_GetError());
-        }
+        LOG_DEBUG("error occurs reading file %s", filename.string().c_str());
+        return std::nullopt;
     }
+    std::istringstream file{ std::string{ reinterpret_cast<char const*>(data.data()),
+                                          data.size() } };
 
     std::vector<mesh::coord_type> normals;
+    std::vector<mesh::coord_type> texcoords;
 
     // TODO: rewrite
     std::string line;
@@ -113,12 +63,24 @@ load_obj(std::filesystem::path const& filename)
                 normals.push_back(y);
                 normals.push_back(z);
             }
+        } else if (prefix == "vt")
+        {
+            float u{}, v{};
+            if (iss >> u >> v)
+            {
+                texcoords.push_back(u);
+                texcoords.push_back(v);
+            }
         } else if (prefix == "f")
         {
             if (res.normals.empty())
             {
                 res.normals.resize(res.vertices.size());
             }
+            if (res.texcoords.empty() && !texcoords.empty())
+            {
+                res.texcoords.resize(res.vertices.size() / 3 * 2);
+            }
 
             std::string tok;
             while (iss >> tok)
@@ -134,6 +96,12 @@ load_obj(std::filesystem::path const& filename)
                 res.normals.at((v - 1) * stride) = normals[vn - 1];
                 res.normals.at((v - 1) * stride + 1) = normals[vn];
                 res.normals.at((v - 1) * stride + 2) = normals[vn + 1];
+
+                if (!res.texcoords.empty())
+                {
+                    res.texcoords.at((v - 1) * 2) = texcoords.at((vt - 1) * 2);
+                    res.texcoords.at((v - 1) * 2 + 1) = texcoords.at((vt - 1) * 2 + 1);
+                }
             }
         }
     }
@@ -184,6 +152,19 @@ load_gltf(std::filesystem::path const& filename)
                     normal_accessor.count * sizeof(float) * 3);
     }
 
+    if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end())
+    {
+        const tinygltf::Accessor& texcoord_accessor =
+            model.accessors[primitive.attributes.at("TEXCOORD_0")];
+        const tinygltf::BufferView& texcoord_buffer_view = model.bufferViews[texcoord_accessor.bufferView];
+        const tinygltf::Buffer& texcoord_buffer = model.buffers[texcoord_buffer_view.buffer];
+
+        res.texcoords.resize(texcoord_accessor.count * 2);
+        std::memcpy(res.texcoords.data(),
+                    texcoord_buffer.data.data() + texcoord_buffer_view.byteOffset + texcoord_accessor.byteOffset,
+                    texcoord_accessor.count * sizeof(float) * 2);
+    }
+
     if (primitive.indices >= 0)
     {
         const tinygltf::Accessor& index_accessor = model.accessors[primitive.indices];
@@ -0,0 +1,142 @@
+#include <engine/context.hpp>
+#include <engine/error.hpp>
+#include <engine/object_picker.hpp>
+
+#include <glad/glad.h>
+
+#include <glm/common.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+namespace dg
+{
+
+namespace
+{
+
+constexpr std::string_view fragment_shader_src = R"(
+#version 320 es
+
+uniform highp uint object_id;
+
+layout (location = 0) out highp uint id;
+
+void main()
+{
+    id = object_id;
+}
+)";
+
+} // namespace
+
+object_picker::object_picker(context& c)
+    : ctx(c)
+    , program(depth_only_program(c, fragment_shader_src))
+    , pipeline(c, pipeline_state::desc{ .program = &program })
+    , id_target(c, texture::target_t::texture_2d, texture::format_t::r32ui, glm::u32vec2{ 1 }, 1)
+    , depth_target(c, texture::target_t::texture_2d, texture::format_t::depth24, glm::u32vec2{ 1 },
+                   1)
+    , render_target(c)
+    , readbacks{ readback{ .pixels = buffer{ c, buffer::target_t::pixel_pack } },
+                 readback{ .pixels = buffer{ c, buffer::target_t::pixel_pack } },
+                 readback{ .pixels = buffer{ c, buffer::target_t::pixel_pack } } }
+{
+    // GLES guarantees reads of unsigned integer targets only as RGBA, so each slot holds 4 ids
+    for (auto& r : readbacks) r.pixels.load(buffer::data_t::readback, {}, 4 * sizeof(uint32_t));
+
+    render_target.attach(id_target);
+    render_target.attach(depth_target);
+    render_target.validate("picking");
+}
+
+object_picker::~object_picker()
+{
+    for (auto const& r : readbacks)
+    {
+        if (r.fence) GL_CHECK(glDeleteSync(static_cast<GLsync>(r.fence)));
+    }
+}
+
+void
+object_picker::pick(glm::mat4 const& view_proj, glm::vec2 cursor, std::span<item const> items)
+{
+    // free slot, otherwise the oldest one is dropped
+    auto& r = *std::ranges::min_element(readbacks, {}, &readback::serial);
+    if (r.fence) GL_CHECK(glDeleteSync(static_cast<GLsync>(r.fence)));
+
+    // scales NDC so the pixel under cursor covers whole 1x1 viewport, window coordinates of
+    // cursor are scaled on high density displays, so they are mapped to drawable pixels first
+    glm::vec2 const size{ ctx.drawable_size() };
+    glm::vec2 const pixel{ glm::floor(cursor * size / glm::vec2{ ctx.window_size() }) + 0.5f };
+    glm::vec2 const center{ 2.0f * pixel.x / size.x - 1.0f, 1.0f - 2.0f * pixel.y / size.y };
+    glm::mat4 const narrow = glm::scale(glm::translate(glm::mat4{ 1.0f },
+                                                       glm::vec3{ -center * size, 0.0f }),
+                                        glm::vec3{ size, 1.0f });
+    glm::mat4 const pick_view_proj = narrow * view_proj;
+
+    std::array<GLint, 4> prev_viewport{};
+    GL_CHECK(glGetIntegerv(GL_VIEWPORT, prev_viewport.data()));
+    auto const prev_framebuffer = render_target.bind();
+    GL_CHECK(glViewport(0, 0, 1, 1));
+
+    pipeline.apply();
+    GLuint const clear_id[4]{ no_object, 0, 0, 0 };
+    GL_CHECK(glClearBufferuiv(GL_COLOR, 0, clear_id));
+    GLfloat const clear_depth{ 1.0f };
+    GL_CHECK(glClearBufferfv(GL_DEPTH, 0, &clear_depth));
+
+    for (auto const& i : items)
+    {
+        program.uniform("object_id", i.id);
+        i.mesh.draw(program, pick_view_proj);
+    }
+    ctx.frame_stats().draw_calls += items.size();
+
+    // copy goes to the buffer asynchronously, fence tells when it is there
+    auto const prev_pack = r.pixels.bind();
+    GL_CHECK(glReadPixels(0, 0, 1, 1, GL_RGBA_INTEGER, GL_UNSIGNED_INT, nullptr));
+    r.pixels.unbind(prev_pack);
+    GLsync fence{ nullptr };
+    GL_CHECK(fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    r.fence = fence;
+    r.serial = next_serial++;
+
+    render_target.unbind(prev_framebuffer);
+    GL_CHECK(glViewport(prev_viewport[0], prev_viewport[1], prev_viewport[2], prev_viewport[3]));
+}
+
+std::optional<uint32_t>
+object_picker::poll()
+{
+    std::optional<uint32_t> res;
+    uint64_t latest{ 0 };
+    for (auto& r : readbacks)
+    {
+        if (!r.fence) continue;
+
+        auto* const fence = static_cast<GLsync>(r.fence);
+        GLint status{ GL_UNSIGNALED };
+        GL_CHECK(glGetSynciv(fence, GL_SYNC_STATUS, sizeof(status), nullptr, &status));
+        if (status != GL_SIGNALED) continue;
+
+        GL_CHECK(glDeleteSync(fence));
+        r.fence = nullptr;
+
+        std::array<uint32_t, 4> pixel{ no_object, 0, 0, 0 };
+        r.pixels.read(0, std::span<uint32_t>{ pixel });
+        if (r.serial > latest)
+        {
+            latest = r.serial;
+            res = pixel[0];
+        }
+        // finished slots are reused first
+        r.serial = 0;
+    }
+
+    return res;
+}
+
+} // namespace dg
@@ -0,0 +1,366 @@
+#include <engine/occlusion_culler.hpp>
+#include <engine/thread_pool.hpp>
+
+#include <glm/common.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define DG_OCCLUSION_SSE 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define DG_OCCLUSION_NEON 1
+#endif
+
+namespace dg
+{
+
+namespace
+{
+
+// vertices this close to camera plane aren't projected
+constexpr float min_w{ 1e-5f };
+
+///! writes `min(row, z)` to pixels `[begin, end)` of `row` which are inside of all `edges`,
+///! `begin` and `end` are multiples of 4
+void
+rasterize_span(float* row, int begin, int end, float y, glm::vec3 const (&edges)[3],
+               glm::vec3 const& depth)
+{
+#if defined(DG_OCCLUSION_SSE)
+    // edge and depth values at 4 pixel centers, stepped by 4 pixels
+    __m128 const px{ _mm_add_ps(_mm_set1_ps(static_cast<float>(begin)),
+                                _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f)) };
+    __m128 e[3];
+    __m128 de[3];
+    for (int i{ 0 }; i < 3; ++i)
+    {
+        e[i] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edges[i].x), px),
+                          _mm_set1_ps(edges[i].y * y + edges[i].z));
+        de[i] = _mm_set1_ps(edges[i].x * 4.0f);
+    }
+    __m128 z{ _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depth.x), px),
+                         _mm_set1_ps(depth.y * y + depth.z)) };
+    __m128 const dz{ _mm_set1_ps(depth.x * 4.0f) };
+    __m128 const zero{ _mm_setzero_ps() };
+
+    for (int x{ begin }; x < end; x += 4)
+    {
+        __m128 const inside{ _mm_and_ps(
+            _mm_and_ps(_mm_cmpge_ps(e[0], zero), _mm_cmpge_ps(e[1], zero)),
+            _mm_cmpge_ps(e[2], zero)) };
+        if (_mm_movemask_ps(inside) != 0)
+        {
+            __m128 const old{ _mm_loadu_ps(row + x) };
+            __m128 const nearest{ _mm_min_ps(old, z) };
+            _mm_storeu_ps(row + x,
+                          _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+        }
+        for (int i{ 0 }; i < 3; ++i) e[i] = _mm_add_ps(e[i], de[i]);
+        z = _mm_add_ps(z, dz);
+    }
+#elif defined(DG_OCCLUSION_NEON)
+    float32x4_t const lane{ 0.5f, 1.5f, 2.5f, 3.5f };
+    float32x4_t const px{ vaddq_f32(vdupq_n_f32(static_cast<float>(begin)), lane) };
+    float32x4_t e[3];
+    float32x4_t de[3];
+    for (int i{ 0 }; i < 3; ++i)
+    {
+        e[i] = vmlaq_n_f32(vdupq_n_f32(edges[i].y * y + edges[i].z), px, edges[i].x);
+        de[i] = vdupq_n_f32(edges[i].x * 4.0f);
+    }
+    float32x4_t z{ vmlaq_n_f32(vdupq_n_f32(depth.y * y + depth.z), px, depth.x) };
+    float32x4_t const dz{ vdupq_n_f32(depth.x * 4.0f) };
+    float32x4_t const zero{ vdupq_n_f32(0.0f) };
+
+    for (int x{ begin }; x < end; x += 4)
+    {
+        uint32x4_t const inside{ vandq_u32(
+            vandq_u32(vcgeq_f32(e[0], zero), vcgeq_f32(e[1], zero)), vcgeq_f32(e[2], zero)) };
+        if (vmaxvq_u32(inside) != 0)
+        {
+            float32x4_t const old{ vld1q_f32(row + x) };
+            vst1q_f32(row + x, vbslq_f32(inside, vminq_f32(old, z), old));
+        }
+        for (int i{ 0 }; i < 3; ++i) e[i] = vaddq_f32(e[i], de[i]);
+        z = vaddq_f32(z, dz);
+    }
+#else
+    for (int x{ begin }; x < end; ++x)
+    {
+        float const px{ static_cast<float>(x) + 0.5f };
+        bool inside{ true };
+        for (auto const& edge : edges) inside = inside && edge.x * px + edge.y * y + edge.z >= 0.0f;
+        if (inside) row[x] = std::min(row[x], depth.x * px + depth.y * y + depth.z);
+    }
+#endif
+}
+
+} // namespace
+
+occlusion_culler::occlusion_culler(glm::u32vec2 resolution)
+{
+    assert(resolution.x > 0 && resolution.y > 0);
+
+    glm::u32vec2 size{ (resolution.x + 3) / 4 * 4, resolution.y };
+    while (true)
+    {
+        sizes.push_back(size);
+        hierarchy.emplace_back(std::size_t{ size.x } * size.y, 1.0f);
+        if (size.x == 1 && size.y == 1) break;
+
+        size = { (size.x + 1) / 2, (size.y + 1) / 2 };
+    }
+}
+
+void
+occlusion_culler::begin(glm::mat4 const& vp)
+{
+    view_proj = vp;
+    triangles.clear();
+    for (auto& level : hierarchy) std::ranges::fill(level, 1.0f);
+}
+
+void
+occlusion_culler::add_occluder(glm::mat4 const& model, std::span<float const> vertices,
+                               std::span<uint32_t const> indices)
+{
+    glm::mat4 const mvp{ view_proj * model };
+    glm::vec2 const size{ sizes[0] };
+
+    for (std::size_t i{ 0 }; i + 2 < indices.size(); i += 3)
+    {
+        // screen x, y in pixels and depth
+        glm::vec3 v[3];
+        bool is_clipped{ false };
+        for (std::size_t k{ 0 }; k < 3; ++k)
+        {
+            std::size_t const base{ std::size_t{ indices[i + k] } * 3 };
+            glm::vec4 const clip{ mvp
+                                  * glm::vec4{ vertices[base], vertices[base + 1],
+                                               vertices[base + 2], 1.0f } };
+            if (clip.w < min_w || clip.z < -clip.w)
+            {
+                is_clipped = true;
+                break;
+            }
+            glm::vec3 const ndc{ glm::vec3(clip) / clip.w };
+            v[k] = { (ndc.x * 0.5f + 0.5f) * size.x, (ndc.y * 0.5f + 0.5f) * size.y,
+                     ndc.z * 0.5f + 0.5f };
+        }
+        if (is_clipped) continue;
+
+        // occluders are double sided, so winding is made counter clockwise
+        float area{ (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y) };
+        if (area == 0.0f) continue;
+        if (area < 0.0f)
+        {
+            std::swap(v[1], v[2]);
+            area = -area;
+        }
+
+        triangle t;
+        for (std::size_t k{ 0 }; k < 3; ++k)
+        {
+            glm::vec3 const& a = v[k];
+            glm::vec3 const& b = v[(k + 1) % 3];
+            t.edges[k] = { a.y - b.y, b.x - a.x, a.x * b.y - a.y * b.x };
+        }
+
+        float const dzdx{ ((v[1].z - v[0].z) * (v[2].y - v[0].y)
+                           - (v[2].z - v[0].z) * (v[1].y - v[0].y))
+                          / area };
+        float const dzdy{ ((v[2].z - v[0].z) * (v[1].x - v[0].x)
+                           - (v[1].z - v[0].z) * (v[2].x - v[0].x))
+                          / area };
+        t.depth = { dzdx, dzdy, v[0].z - dzdx * v[0].x - dzdy * v[0].y };
+
+        glm::vec2 const lo{ glm::min(glm::min(glm::vec2(v[0]), glm::vec2(v[1])), glm::vec2(v[2])) };
+        glm::vec2 const hi{ glm::max(glm::max(glm::vec2(v[0]), glm::vec2(v[1])), glm::vec2(v[2])) };
+        t.min = { std::max(0, static_cast<int>(std::floor(lo.x))),
+                  std::max(0, static_cast<int>(std::floor(lo.y))) };
+        t.max = { std::min(static_cast<int>(sizes[0].x) - 1, static_cast<int>(std::floor(hi.x))),
+                  std::min(static_cast<int>(sizes[0].y) - 1, static_cast<int>(std::floor(hi.y))) };
+        if (t.min.x > t.max.x || t.min.y > t.max.y) continue;
+
+        triangles.push_back(t);
+    }
+}
+
+void
+occlusion_culler::rasterize()
+{
+    uint32_t const tiles{ (sizes[0].y + tile_height - 1) / tile_height };
+    for (uint32_t tile{ 0 }; tile < tiles; ++tile) rasterize_tile(tile);
+    build_hierarchy();
+}
+
+void
+occlusion_culler::rasterize(thread_pool& pool)
+{
+    // tiles are disjoint rows, so jobs never write the same pixels
+    uint32_t const tiles{ (sizes[0].y + tile_height - 1) / tile_height };
+    pool.parallel_for(tiles,
+                      [this](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t tile{ begin }; tile < end; ++tile)
+                          {
+                              rasterize_tile(static_cast<uint32_t>(tile));
+                          }
+                      });
+    build_hierarchy();
+}
+
+void
+occlusion_culler::rasterize_tile(uint32_t tile)
+{
+    int const width{ static_cast<int>(sizes[0].x) };
+    int const tile_begin{ static_cast<int>(tile * tile_height) };
+    int const tile_end{ std::min(tile_begin + static_cast<int>(tile_height),
+                                 static_cast<int>(sizes[0].y)) };
+    auto& depth = hierarchy[0];
+
+    for (auto const& t : triangles)
+    {
+        int const y_begin{ std::max(t.min.y, tile_begin) };
+        int const y_end{ std::min(t.max.y + 1, tile_end) };
+        // starts at SIMD register boundary, width is multiple of 4
+        int const x_begin{ t.min.x & ~3 };
+        int const x_end{ std::min((t.max.x + 4) & ~3, width) };
+        for (int y{ y_begin }; y < y_end; ++y)
+        {
+            float* const row{ depth.data() + static_cast<std::ptrdiff_t>(y) * width };
+            rasterize_span(row, x_begin, x_end, static_cast<float>(y) + 0.5f, t.edges, t.depth);
+        }
+    }
+}
+
+void
+occlusion_culler::build_hierarchy()
+{
+    for (std::size_t level{ 1 }; level < hierarchy.size(); ++level)
+    {
+        glm::u32vec2 const src_size{ sizes[level - 1] };
+        glm::u32vec2 const dst_size{ sizes[level] };
+        auto const& src = hierarchy[level - 1];
+        auto& dst = hierarchy[level];
+
+        auto const at = [&](uint32_t x, uint32_t y)
+        { return src[std::size_t{ y } * src_size.x + x]; };
+
+        // odd sizes repeat the last row or column
+        for (uint32_t y{ 0 }; y < dst_size.y; ++y)
+        {
+            uint32_t const y0{ 2 * y };
+            uint32_t const y1{ std::min(2 * y + 1, src_size.y - 1) };
+            for (uint32_t x{ 0 }; x < dst_size.x; ++x)
+            {
+                uint32_t const x0{ 2 * x };
+                uint32_t const x1{ std::min(2 * x + 1, src_size.x - 1) };
+                dst[std::size_t{ y } * dst_size.x + x] =
+                    std::max({ at(x0, y0), at(x1, y0), at(x0, y1), at(x1, y1) });
+            }
+        }
+    }
+}
+
+bool
+occlusion_culler::is_visible(aabb const& box) const
+{
+    glm::vec2 lo{ std::numeric_limits<float>::max() };
+    glm::vec2 hi{ std::numeric_limits<float>::lowest() };
+    float nearest{ 1.0f };
+    for (uint32_t c{ 0 }; c < 8; ++c)
+    {
+        glm::vec4 const corner{ c & 1 ? box.max.x : box.min.x, c & 2 ? box.max.y : box.min.y,
+                                c & 4 ? box.max.z : box.min.z, 1.0f };
+        glm::vec4 const clip{ view_proj * corner };
+        if (clip.w < min_w || clip.z < -clip.w) return true;
+
+        glm::vec3 const ndc{ glm::vec3(clip) / clip.w };
+        lo = glm::min(lo, glm::vec2(ndc));
+        hi = glm::max(hi, glm::vec2(ndc));
+        nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+    }
+    if (hi.x < -1.0f || lo.x > 1.0f || hi.y < -1.0f || lo.y > 1.0f) return true;
+
+    glm::vec2 const size{ sizes[0] };
+    glm::ivec2 const max_pixel{ glm::ivec2(sizes[0]) - 1 };
+    auto const to_pixel = [&](glm::vec2 ndc)
+    {
+        glm::vec2 const p{ glm::floor((ndc * 0.5f + 0.5f) * size) };
+        return glm::ivec2{ std::clamp(static_cast<int>(p.x), 0, max_pixel.x),
+                           std::clamp(static_cast<int>(p.y), 0, max_pixel.y) };
+    };
+    glm::ivec2 const p0{ to_pixel(lo) };
+    glm::ivec2 const p1{ to_pixel(hi) };
+
+    // the coarsest level where rectangle is still at most ~2 texels across
+    uint32_t level{ 0 };
+    int extent{ std::max(p1.x - p0.x, p1.y - p0.y) };
+    while (extent > 1 && level + 1 < hierarchy.size())
+    {
+        extent >>= 1;
+        ++level;
+    }
+
+    auto const& depth = hierarchy[level];
+    uint32_t const width{ sizes[level].x };
+    float farthest{ 0.0f };
+    for (int y{ p0.y >> level }; y <= p1.y >> level; ++y)
+    {
+        for (int x{ p0.x >> level }; x <= p1.x >> level; ++x)
+        {
+            farthest = std::max(farthest, depth[static_cast<std::size_t>(y) * width
+                                                + static_cast<std::size_t>(x)]);
+        }
+    }
+
+    return nearest <= farthest;
+}
+
+void
+occlusion_culler::cull(thread_pool& pool, std::span<aabb const> boxes,
+                       std::vector<uint32_t>& ids) const
+{
+    std::vector<uint8_t> is_visible_id(ids.size());
+    pool.parallel_for(
+        ids.size(),
+        [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i{ begin }; i < end; ++i) is_visible_id[i] = is_visible(boxes[ids[i]]);
+        },
+        64);
+
+    std::size_t size{ 0 };
+    for (std::size_t i{ 0 }; i < ids.size(); ++i)
+    {
+        if (is_visible_id[i]) ids[size++] = ids[i];
+    }
+    ids.resize(size);
+}
+
+uint32_t
+occlusion_culler::levels() const
+{
+    return static_cast<uint32_t>(hierarchy.size());
+}
+
+glm::u32vec2
+occlusion_culler::size(uint32_t level) const
+{
+    return sizes[level];
+}
+
+std::span<float const>
+occlusion_culler::depth(uint32_t level) const
+{
+    return hierarchy[level];
+}
+
+} // namespace dg
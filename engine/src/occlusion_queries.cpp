@@ -0,0 +1,171 @@
+#include <engine/context.hpp>
+#include <engine/deletion_queue.hpp>
+#include <engine/depth_only.hpp>
+#include <engine/error.hpp>
+#include <engine/occlusion_queries.hpp>
+
+#include <glad/glad.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/vec4.hpp>
+
+namespace dg
+{
+
+namespace
+{
+
+// unit cube, scaled and moved to each box
+std::vector<float> const box_vertices{ 0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0,
+                                       0, 0, 1, 1, 0, 1, 0, 1, 1, 1, 1, 1 };
+std::vector<uint32_t> const box_indices{ 0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+                                         2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5 };
+
+// queries are generated in batches when pool runs out
+constexpr GLsizei query_batch{ 64 };
+
+///! box with a corner behind near plane can't be tested by rasterization, camera may be inside
+bool
+is_crossing_near_plane(glm::mat4 const& view_proj, aabb const& box)
+{
+    for (uint32_t c{ 0 }; c < 8; ++c)
+    {
+        glm::vec4 const corner{ c & 1 ? box.max.x : box.min.x, c & 2 ? box.max.y : box.min.y,
+                                c & 4 ? box.max.z : box.min.z, 1.0f };
+        glm::vec4 const clip{ view_proj * corner };
+        if (clip.z < -clip.w) return true;
+    }
+
+    return false;
+}
+
+} // namespace
+
+occlusion_queries::occlusion_queries(context& c)
+    : ctx(c)
+    , program(depth_only_program(c))
+    , pipeline(c, pipeline_state::desc{
+                      .program = &program,
+                      .vertex_layout = &box,
+                      .depth = { .write = false, .func = pipeline_state::compare_t::less_equal } })
+    , box(c)
+{
+    box.load(0, vertex_array::data_t::immutable, box_vertices);
+    box.load_indices(vertex_array::data_t::immutable, box_indices);
+}
+
+occlusion_queries::~occlusion_queries()
+{
+    for (auto const& o : objects)
+    {
+        if (o.query) ctx.deletions().push(deletion_queue::object_t::query, o.query);
+    }
+    for (auto const q : free_queries) ctx.deletions().push(deletion_queue::object_t::query, q);
+}
+
+void
+occlusion_queries::poll()
+{
+    ++frame;
+
+    auto& stats = ctx.frame_stats();
+    std::size_t size{ 0 };
+    for (uint32_t const id : pending)
+    {
+        object& o = objects[id];
+        GLuint is_available{ GL_FALSE };
+        GL_CHECK(glGetQueryObjectuiv(o.query, GL_QUERY_RESULT_AVAILABLE, &is_available));
+        if (!is_available)
+        {
+            pending[size++] = id;
+            continue;
+        }
+
+        GLuint samples_passed{ GL_FALSE };
+        GL_CHECK(glGetQueryObjectuiv(o.query, GL_QUERY_RESULT, &samples_passed));
+        o.is_visible = samples_passed != GL_FALSE;
+        o.result_frame = o.issued_frame;
+        free_queries.push_back(o.query);
+        o.query = 0;
+
+        ++stats.occlusion_results;
+        stats.occlusion_latency_frames += frame - o.issued_frame;
+    }
+    pending.resize(size);
+}
+
+void
+occlusion_queries::cull(std::vector<uint32_t>& ids)
+{
+    std::size_t size{ 0 };
+    for (uint32_t const id : ids)
+    {
+        bool const is_occluded{ id < objects.size() && !objects[id].is_visible
+                                && frame - objects[id].result_frame <= max_result_age };
+        if (!is_occluded) ids[size++] = id;
+    }
+    ctx.frame_stats().occlusion_culled += ids.size() - size;
+    ids.resize(size);
+}
+
+void
+occlusion_queries::issue(glm::mat4 const& view_proj, std::span<aabb const> boxes,
+                         std::span<uint32_t const> ids)
+{
+    pipeline.apply();
+    GL_CHECK(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+
+    uint64_t issued{ 0 };
+    for (uint32_t const id : ids)
+    {
+        if (id >= objects.size()) objects.resize(id + 1);
+        object& o = objects[id];
+        if (o.query) continue;
+
+        aabb const& b = boxes[id];
+        if (is_crossing_near_plane(view_proj, b))
+        {
+            o.is_visible = true;
+            o.result_frame = frame;
+            continue;
+        }
+
+        draw_item const item{
+            .vao = &box,
+            .index_count = static_cast<uint32_t>(box_indices.size()),
+            .model = glm::scale(glm::translate(glm::mat4{ 1.0f }, b.min), b.max - b.min)
+        };
+
+        o.query = acquire();
+        o.issued_frame = frame;
+        pending.push_back(id);
+
+        GL_CHECK(glBeginQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, o.query));
+        item.draw(program, view_proj);
+        GL_CHECK(glEndQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE));
+        ++issued;
+    }
+
+    GL_CHECK(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+
+    auto& stats = ctx.frame_stats();
+    stats.occlusion_queries += issued;
+    stats.draw_calls += issued;
+}
+
+occlusion_queries::handle_t
+occlusion_queries::acquire()
+{
+    if (free_queries.empty())
+    {
+        free_queries.resize(query_batch);
+        GL_CHECK(glGenQueries(query_batch, free_queries.data()));
+    }
+
+    handle_t const q{ free_queries.back() };
+    free_queries.pop_back();
+
+    return q;
+}
+
+} // namespace dg
@@ -0,0 +1,89 @@
+#include <engine/context.hpp>
+#include <engine/gl_state.hpp>
+#include <engine/hash.hpp>
+#include <engine/pipeline_state.hpp>
+#include <engine/shader_program.hpp>
+#include <engine/util.hpp>
+#include <engine/vertex_array.hpp>
+
+#include <array>
+#include <cassert>
+#include <span>
+
+namespace dg
+{
+
+namespace
+{
+
+uint64_t
+hash_of(pipeline_state::desc const& d)
+{
+    // fields are packed explicitly, padding bytes of `desc` are indeterminate
+    std::array<uint64_t, 4> const packed{
+        reinterpret_cast<uintptr_t>(d.program),
+        reinterpret_cast<uintptr_t>(d.vertex_layout),
+        uint64_t{ d.depth.test } | uint64_t{ d.depth.write } << 1 | uint64_t{ d.blend.enable } << 2
+            | uint64_t{ d.cull.enable } << 3 | uint64_t{ to_underlying(d.depth.func) } << 8
+            | uint64_t{ to_underlying(d.cull.face) } << 16,
+        uint64_t{ to_underlying(d.blend.src) } | uint64_t{ to_underlying(d.blend.dst) } << 8,
+    };
+
+    return fnv1a(std::as_bytes(std::span{ packed }));
+}
+
+} // namespace
+
+pipeline_state::pipeline_state(context& c, desc const& d)
+    : ctx(&c)
+    , state(d)
+    , key(hash_of(d))
+{
+    assert(state.program);
+}
+
+void
+pipeline_state::apply() const
+{
+    auto& gl = ctx->state();
+
+    state.program->bind();
+    if (state.vertex_layout) state.vertex_layout->bind();
+
+    gl.enable(context::capability::depth_test, state.depth.test);
+    gl.depth_mask(state.depth.write);
+    if (state.depth.test) gl.depth_func(state.depth.func);
+
+    gl.enable(context::capability::blend, state.blend.enable);
+    if (state.blend.enable) gl.blend_func(state.blend.src, state.blend.dst);
+
+    gl.enable(context::capability::cull_face, state.cull.enable);
+    if (state.cull.enable) gl.cull_face(state.cull.face);
+}
+
+pipeline_state::desc const&
+pipeline_state::description() const
+{
+    return state;
+}
+
+uint64_t
+pipeline_state::hash() const
+{
+    return key;
+}
+
+bool
+operator==(pipeline_state const& l, pipeline_state const& r)
+{
+    auto const& a = l.state;
+    auto const& b = r.state;
+
+    return l.key == r.key && a.program == b.program && a.vertex_layout == b.vertex_layout
+           && a.depth.test == b.depth.test && a.depth.write == b.depth.write
+           && a.depth.func == b.depth.func && a.blend.enable == b.blend.enable
+           && a.blend.src == b.blend.src && a.blend.dst == b.blend.dst
+           && a.cull.enable == b.cull.enable && a.cull.face == b.cull.face;
+}
+
+} // namespace dg
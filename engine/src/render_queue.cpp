@@ -0,0 +1,207 @@
+#include <engine/command_list.hpp>
+#include <engine/context.hpp>
+#include <engine/error.hpp>
+#include <engine/pipeline_state.hpp>
+#include <engine/render_queue.hpp>
+#include <engine/shader_program.hpp>
+#include <engine/thread_pool.hpp>
+#include <engine/vertex_array.hpp>
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <numeric>
+#include <utility>
+
+namespace dg
+{
+
+render_queue::render_queue(context& c)
+    : render_queue(c, object_uniforms{})
+{
+}
+
+render_queue::render_queue(context& c, object_uniforms n)
+    : ctx(c)
+    , names(n)
+{
+}
+
+render_queue::~render_queue() = default;
+
+uint32_t
+render_queue::quantize_depth(float distance, float max_distance)
+{
+    constexpr float max_value{ 0xFF'FFFF };
+    float const t{ std::clamp(distance / max_distance, 0.0f, 1.0f) };
+
+    return static_cast<uint32_t>(t * max_value);
+}
+
+void
+render_queue::push(draw const& d)
+{
+    assert(d.pipeline && d.vao);
+
+    draws.push_back(d);
+    keys.push_back(d.key);
+}
+
+void
+render_queue::push(command_list const& list)
+{
+    for (draw const& d : list.draws()) push(d);
+}
+
+void
+render_queue::record(thread_pool& pool, std::size_t count,
+                     std::function<void(command_list&, std::size_t, std::size_t)> const& fn,
+                     std::size_t min_chunk)
+{
+    // parallel_for never makes more chunks than threads
+    lists.resize(pool.size() + 1);
+    std::atomic<std::size_t> next{ 0 };
+
+    pool.parallel_for(
+        count,
+        [&](std::size_t begin, std::size_t end)
+        {
+            auto& list = lists[next.fetch_add(1, std::memory_order_relaxed)];
+            fn(list, begin, end);
+        },
+        min_chunk);
+
+    // parallel_for has joined, so lists are visible here
+    for (std::size_t i{ 0 }; i < next.load(std::memory_order_relaxed); ++i)
+    {
+        push(lists[i]);
+        lists[i].clear();
+    }
+}
+
+void
+render_queue::submit()
+{
+    if (prepass_pipeline) submit_depth_prepass();
+
+    radix_sort(keys, order);
+
+    pipeline_state const* pipeline{ nullptr };
+    vertex_array* vao{ nullptr };
+    shader_program* program{ nullptr };
+    for (uint32_t const i : order)
+    {
+        draw const& d = draws[i];
+        if (d.pipeline != pipeline)
+        {
+            pipeline = d.pipeline;
+            pipeline->apply();
+            program = pipeline->description().program;
+        }
+        if (d.vao != vao)
+        {
+            vao = d.vao;
+            vao->bind();
+        }
+
+        // unchanged values are skipped by program uniform cache
+        program->uniform(names.model, d.model);
+        program->uniform(names.normal_mat, d.normal_mat);
+        program->uniform(names.color, d.color);
+
+        auto const offset{ static_cast<uintptr_t>(d.first_index) * sizeof(uint32_t) };
+        GL_CHECK(glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(d.index_count), GL_UNSIGNED_INT,
+                                reinterpret_cast<void const*>(offset)));
+    }
+    ctx.frame_stats().draw_calls += draws.size();
+
+    draws.clear();
+    keys.clear();
+}
+
+void
+render_queue::depth_prepass(pipeline_state const* pipeline, uint32_t pass)
+{
+    prepass_pipeline = pipeline;
+    prepass_pass = pass;
+}
+
+void
+render_queue::submit_depth_prepass()
+{
+    // fields as packed by `sort_key::pack`
+    prepass_draws.clear();
+    prepass_keys.clear();
+    for (uint32_t i{ 0 }; i < draws.size(); ++i)
+    {
+        if ((keys[i] >> 60) != (prepass_pass & 0xFu)) continue;
+
+        prepass_draws.push_back(i);
+        prepass_keys.push_back(keys[i] & 0xFF'FFFFu);
+    }
+    if (prepass_draws.empty()) return;
+
+    // only depth bytes differ, so sort is at most 3 passes
+    radix_sort(prepass_keys, order);
+
+    prepass_pipeline->apply();
+    shader_program* const program{ prepass_pipeline->description().program };
+    vertex_array* vao{ nullptr };
+    for (uint32_t const i : order)
+    {
+        draw const& d = draws[prepass_draws[i]];
+        if (d.vao != vao)
+        {
+            vao = d.vao;
+            vao->bind();
+        }
+
+        program->uniform(names.model, d.model);
+
+        auto const offset{ static_cast<uintptr_t>(d.first_index) * sizeof(uint32_t) };
+        GL_CHECK(glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(d.index_count), GL_UNSIGNED_INT,
+                                reinterpret_cast<void const*>(offset)));
+    }
+    ctx.frame_stats().draw_calls += prepass_draws.size();
+}
+
+std::size_t
+render_queue::size() const
+{
+    return draws.size();
+}
+
+void
+render_queue::radix_sort(std::span<uint64_t const> keys, std::vector<uint32_t>& order)
+{
+    auto const count{ static_cast<uint32_t>(keys.size()) };
+    order.resize(count);
+    std::iota(order.begin(), order.end(), 0u);
+    if (count < 2) return;
+
+    // all histograms in one pass over keys
+    std::array<std::array<uint32_t, 256>, 8> histograms{};
+    for (uint64_t const k : keys)
+    {
+        for (uint32_t byte{ 0 }; byte < 8; ++byte) ++histograms[byte][(k >> (byte * 8)) & 0xFF];
+    }
+
+    std::vector<uint32_t> scratch(count);
+    for (uint32_t byte{ 0 }; byte < 8; ++byte)
+    {
+        auto& histogram = histograms[byte];
+        // every key has the same value of this byte, order doesn't change
+        if (histogram[(keys[0] >> (byte * 8)) & 0xFF] == count) continue;
+
+        uint32_t sum{ 0 };
+        for (auto& h : histogram) sum += std::exchange(h, sum);
+
+        for (uint32_t const i : order) scratch[histogram[(keys[i] >> (byte * 8)) & 0xFF]++] = i;
+        order.swap(scratch);
+    }
+}
+
+} // namespace dg
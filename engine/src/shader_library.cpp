@@ -0,0 +1,189 @@
+#include <engine/shader_library.hpp>
+
+#include <SDL3/SDL_log.h>
+
+#include <cassert>
+#include <format>
+#include <numeric>
+
+namespace dg
+{
+
+namespace
+{
+
+///! inserts `defines` after `#version` line, which must stay first
+std::string
+with_defines(std::string_view src, std::string_view defines)
+{
+    std::size_t pos{ 0 };
+    if (auto const version = src.find("#version"); version != std::string_view::npos)
+    {
+        pos = src.find('\n', version);
+        pos = pos == std::string_view::npos ? src.size() : pos + 1;
+    }
+
+    std::string result;
+    result.reserve(src.size() + defines.size());
+    result.append(src.substr(0, pos)).append(defines).append(src.substr(pos));
+
+    return result;
+}
+
+} // namespace
+
+shader_library::shader_library(context& c)
+    : ctx(c)
+{
+}
+
+shader_library::base_id
+shader_library::add(std::string_view vertex_src, std::string_view fragment_src,
+                    std::vector<feature> features)
+{
+    assert(std::accumulate(features.begin(), features.end(), 0u,
+                           [](uint32_t sum, feature const& f) { return sum + f.bits; })
+           <= 64);
+
+    bases.push_back({ .vertex_src = std::string{ vertex_src },
+                      .fragment_src = std::string{ fragment_src },
+                      .features = std::move(features) });
+
+    return static_cast<base_id>(bases.size() - 1);
+}
+
+shader_library::variant_key
+shader_library::key(base_id id, std::initializer_list<uint32_t> values) const
+{
+    assert(id < bases.size());
+    auto const& features = bases[id].features;
+    assert(values.size() <= features.size());
+
+    variant_key k{ 0 };
+    uint32_t shift{ 0 };
+    auto value = values.begin();
+    for (std::size_t i{ 0 }; i < values.size(); ++i, ++value)
+    {
+        assert(features[i].bits == 64 || *value < (variant_key{ 1 } << features[i].bits));
+
+        k |= variant_key{ *value } << shift;
+        shift += features[i].bits;
+    }
+
+    return k;
+}
+
+void
+shader_library::precompile(base_id id, variant_key k)
+{
+    auto& v = find_or_create(id, k);
+    if (v.is_queued) return;
+
+    v.is_queued = true;
+    queue.push_back({ .base = id, .key = k });
+}
+
+shader_program*
+shader_library::get(base_id id, variant_key k)
+{
+    auto& v = find_or_create(id, k);
+    if (v.status == shader_program::status_t::linked) return &v.program;
+
+    if (!v.is_queued)
+    {
+        v.is_queued = true;
+        queue.push_front({ .base = id, .key = k });
+    }
+
+    return nullptr;
+}
+
+bool
+shader_library::is_failed(base_id id, variant_key k) const
+{
+    assert(id < bases.size());
+    auto const& variants = bases[id].variants;
+    auto const it = variants.find(k);
+
+    return it != variants.end() && it->second.status == shader_program::status_t::failed;
+}
+
+void
+shader_library::pump(uint32_t max_submits)
+{
+    for (uint32_t i{ 0 }; i < max_submits && !queue.empty(); ++i)
+    {
+        submit(queue.front());
+        queue.pop_front();
+    }
+
+    std::erase_if(in_flight,
+                  [this](queued const& q)
+                  {
+                      auto& v = bases[q.base].variants.at(q.key);
+                      try
+                      {
+                          v.status = v.program.poll();
+                      } catch (shader_program::error const& e)
+                      {
+                          // release builds must see it too, `get` just keeps returning nullptr
+                          SDL_LogError(SDL_LOG_CATEGORY_RENDER,
+                                       "shader variant %llx of base %u failed: %s",
+                                       static_cast<unsigned long long>(q.key), q.base, e.what());
+                          v.status = shader_program::status_t::failed;
+                      }
+
+                      return v.status != shader_program::status_t::pending;
+                  });
+}
+
+std::size_t
+shader_library::pending() const
+{
+    return queue.size() + in_flight.size();
+}
+
+shader_library::variant&
+shader_library::find_or_create(base_id id, variant_key k)
+{
+    assert(id < bases.size());
+
+    return bases[id].variants.try_emplace(k, ctx).first->second;
+}
+
+void
+shader_library::submit(queued q)
+{
+    auto& b = bases[q.base];
+    auto& v = b.variants.at(q.key);
+    std::string const defs{ defines(q.base, q.key) };
+
+    v.program.attach_from_src(shader_program::shader_t::vertex, with_defines(b.vertex_src, defs));
+    v.program.attach_from_src(shader_program::shader_t::fragment,
+                              with_defines(b.fragment_src, defs));
+    v.program.link_async();
+    v.status = shader_program::status_t::pending;
+
+    in_flight.push_back(q);
+}
+
+std::string
+shader_library::defines(base_id id, variant_key k) const
+{
+    std::string result;
+    for (auto const& f : bases[id].features)
+    {
+        if (f.bits == 64)
+        {
+            result += std::format("#define {} {}\n", f.name, k);
+            break;
+        }
+
+        result += std::format("#define {} {}\n", f.name, k & ((variant_key{ 1 } << f.bits) - 1));
+        k >>= f.bits;
+    }
+
+    return result;
+}
+
+} // namespace dg
@@ -1,17 +1,71 @@
 #include <engine/bind_guard.hpp>
 #include <engine/context.hpp>
+#include <engine/deletion_queue.hpp>
 #include <engine/error.hpp>
+#include <engine/gl_state.hpp>
+#include <engine/hash.hpp>
 #include <engine/shader_program.hpp>
+#include <engine/util.hpp>
 
 #include <glm/gtc/type_ptr.hpp>
 
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <cstring>
 #include <format>
 
 namespace dg
 {
 
+namespace
+{
+
+// from KHR_parallel_shader_compile, glad is generated for core only
+constexpr GLenum GL_COMPLETION_STATUS_KHR{ 0x91B1 };
+
+///! size of one element of uniform `type` as passed to glUniform*, 0 for not cached types
+uint32_t
+uniform_size(GLenum type)
+{
+    switch (type)
+    {
+    case GL_FLOAT:
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_BOOL:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_2D_SHADOW:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+        return 4;
+    case GL_FLOAT_VEC2:
+        return 8;
+    case GL_FLOAT_VEC3:
+        return 12;
+    case GL_FLOAT_VEC4:
+        return 16;
+    case GL_FLOAT_MAT3:
+        return 36;
+    case GL_FLOAT_MAT4:
+        return 64;
+    default:
+        return 0;
+    }
+}
+
+///! GL reports arrays as "name[0]", they are looked up by plain name
+std::string_view
+strip_array_suffix(std::string_view name)
+{
+    if (name.ends_with("[0]")) name.remove_suffix(3);
+
+    return name;
+}
+
+} // namespace
+
 shader_program::error::error(std::string const& msg)
     : std::runtime_error(msg)
 {
@@ -22,8 +76,9 @@ shader_program::error::error(char const* msg)
 {
 }
 
-shader_program::shader_program(context const& /* ctx */)
-    : handle(glCreateProgram())
+shader_program::shader_program(context& c)
+    : ctx(&c)
+    , handle(glCreateProgram())
 {
     if (handle == 0)
     {
@@ -32,8 +87,19 @@ shader_program::shader_program(context const& /* ctx */)
 }
 
 shader_program::shader_program(shader_program&& other)
-    : handle(other.handle)
+    : ctx(other.ctx)
+    , handle(other.handle)
+    , sources(std::move(other.sources))
+    , shaders(std::move(other.shaders))
+    , binary_file(std::move(other.binary_file))
+    , status(other.status)
+    , uniforms(std::move(other.uniforms))
+    , uniform_values(std::move(other.uniform_values))
+    , uniform_names(std::move(other.uniform_names))
+    , attribute_names(std::move(other.attribute_names))
+    , uniform_block_names(std::move(other.uniform_block_names))
 {
+    other.handle = 0;
 }
 
 shader_program&
@@ -41,25 +107,50 @@ shader_program::operator=(shader_program other)
 {
     using std::swap;
 
+    swap(ctx, other.ctx);
     swap(handle, other.handle);
+    swap(sources, other.sources);
+    swap(shaders, other.shaders);
+    swap(binary_file, other.binary_file);
+    swap(status, other.status);
+    swap(uniforms, other.uniforms);
+    swap(uniform_values, other.uniform_values);
+    swap(uniform_names, other.uniform_names);
+    swap(attribute_names, other.attribute_names);
+    swap(uniform_block_names, other.uniform_block_names);
 
     return *this;
 }
 
-shader_program::~shader_program() { GL_CHECK(glDeleteProgram(handle)); }
+shader_program::~shader_program()
+{
+    if (!ctx) return;
+
+    // link wasn't finished, shaders are released with program
+    for (GLuint const id : shaders) GL_CHECK(glDeleteShader(id));
+
+    ctx->deletions().push(deletion_queue::object_t::program, static_cast<deletion_queue::handle_t>(handle));
+}
 
 void
 shader_program::attach_from_src(shader_t type, std::string_view src)
+{
+    sources.push_back({ type, std::string{ src } });
+}
+
+uint32_t
+shader_program::compile(shader_t type, std::string_view src)
 {
     // clang-format off
     GLenum shader_type = type == shader_t::fragment ? GL_FRAGMENT_SHADER
                        : type == shader_t::vertex ? GL_VERTEX_SHADER
+                       : type == shader_t::compute ? GL_COMPUTE_SHADER
                        : 0;
     // clang-format on
     assert(shader_type != 0);
 
     GLuint id = glCreateShader(shader_type);
-    if (handle == 0)
+    if (id == 0)
     {
         throw error(std::format("error occurs creating shader: {}", glGetError()));
     }
@@ -69,91 +160,427 @@ shader_program::attach_from_src(shader_t type, std::string_view src)
     GL_CHECK(glShaderSource(id, 1, &cstr, &size));
 
     GL_CHECK(glCompileShader(id));
+    GL_CHECK(glAttachShader(handle, id));
+
+    return id;
+}
+
+void
+shader_program::link()
+{
+    link_async();
+    wait();
+}
+
+void
+shader_program::link_async()
+{
+    assert(status != status_t::pending);
 
-    GLint is_success{ GL_FALSE };
-    GL_CHECK(glGetShaderiv(id, GL_COMPILE_STATUS, &is_success));
-    if (is_success != GL_TRUE)
+    binary_file = binary_path();
+    if (load_binary(binary_file))
     {
-        GLsizei log_len{ 0 };
-        std::array<GLchar, 1024> log{ '\0' };
-        GL_CHECK(glGetShaderInfoLog(id, 1024, &log_len, log.data()));
+        sources.clear();
+        reflect();
+        status = status_t::linked;
+        return;
+    }
+
+    for (auto const& [type, src] : sources) shaders.push_back(compile(type, src));
+    sources.clear();
+
+    GL_CHECK(glProgramParameteri(handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    GL_CHECK(glLinkProgram(handle));
+    status = status_t::pending;
+}
+
+shader_program::status_t
+shader_program::poll()
+{
+    if (status != status_t::pending) return status;
 
+    if (ctx->has_extension("GL_KHR_parallel_shader_compile"))
+    {
+        GLint is_completed{ GL_FALSE };
+        GL_CHECK(glGetProgramiv(handle, GL_COMPLETION_STATUS_KHR, &is_completed));
+        if (is_completed != GL_TRUE) return status;
+    }
+
+    return wait();
+}
+
+shader_program::status_t
+shader_program::wait()
+{
+    if (status == status_t::pending) finish();
+
+    return status;
+}
+
+void
+shader_program::finish()
+{
+    // link fails if any shader fails, so compile status is checked only once here
+    std::string log;
+    for (GLuint const id : shaders)
+    {
+        GLint is_success{ GL_FALSE };
+        GL_CHECK(glGetShaderiv(id, GL_COMPILE_STATUS, &is_success));
+        if (is_success != GL_TRUE && log.empty())
+        {
+            GLsizei log_len{ 0 };
+            std::array<GLchar, 1024> buf{ '\0' };
+            GL_CHECK(glGetShaderInfoLog(id, 1024, &log_len, buf.data()));
+            log = buf.data();
+        }
+
+        GL_CHECK(glDetachShader(handle, id));
         GL_CHECK(glDeleteShader(id));
+    }
+    shaders.clear();
 
-        throw error(std::format("compile shader failed with: {}", log.data()));
+    if (!log.empty())
+    {
+        status = status_t::failed;
+        throw error(std::format("compile shader failed with: {}", log));
     }
 
-    GL_CHECK(glAttachShader(handle, id));
+    GLint is_success{ false };
+    GL_CHECK(glGetProgramiv(handle, GL_LINK_STATUS, &is_success));
+    if (!is_success)
+    {
+        status = status_t::failed;
+        std::array<GLchar, 1024> buf{ '\0' };
+        GL_CHECK(glGetProgramInfoLog(handle, 1024, nullptr, buf.data()));
+        throw error(std::format("link program failed with: {}", buf.data()));
+    }
+
+    status = status_t::linked;
+    save_binary(binary_file);
+    reflect();
+}
+
+std::filesystem::path
+shader_program::binary_path() const
+{
+    if (ctx->cache_path().empty()) return {};
+
+    GLint formats{ 0 };
+    GL_CHECK(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats));
+    if (formats == 0) return {};
+
+    // binaries are valid only for the same driver
+    uint64_t key{ fnv1a_offset };
+    for (GLenum const name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+    {
+        auto const* const str = reinterpret_cast<char const*>(glGetString(name));
+        key = fnv1a(str ? str : "", key);
+    }
+    for (auto const& [type, src] : sources)
+    {
+        char const tag{ static_cast<char>(to_underlying(type)) };
+        key = fnv1a(src, fnv1a(std::string_view{ &tag, 1 }, key));
+    }
 
-    GL_CHECK(glDeleteShader(id));
+    return ctx->cache_path() / "programs" / std::format("{:016x}.bin", key);
 }
 
 bool
-shader_program::link()
+shader_program::load_binary(std::filesystem::path const& filename)
 {
-    GL_CHECK(glLinkProgram(handle));
+    std::error_code ec;
+    if (filename.empty() || !std::filesystem::exists(filename, ec)) return false;
+
+    auto const file = load_file(filename);
+    binary_header header{};
+    if (file.size() <= sizeof(header)) return false;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != binary_header{}.magic) return false;
+
+    auto const blob = std::span{ file }.subspan(sizeof(header));
+    // error flags left by earlier unchecked calls would be taken for the one of `glProgramBinary`
+    while (glGetError() != GL_NO_ERROR)
+    {
+    }
+    glProgramBinary(handle, header.format, blob.data(), static_cast<GLsizei>(blob.size()));
+    // not GL_CHECK, because driver update may reject old binary with GL_INVALID_ENUM. It isn't an
+    // error, link status below tells the result, so the flag is only read to clear it
+    if (GLenum const e{ glGetError() }; e != GL_NO_ERROR)
+    {
+        LOG_DEBUG("glProgramBinary of %s sets error 0x%x", filename.string().c_str(), e);
+    }
 
     GLint is_success{ false };
     GL_CHECK(glGetProgramiv(handle, GL_LINK_STATUS, &is_success));
+    if (!is_success)
+    {
+        LOG_DEBUG("program binary %s is stale, recompiling", filename.string().c_str());
+        std::filesystem::remove(filename, ec);
+    }
 
     return is_success;
 }
 
-std::any
-shader_program::bind()
+void
+shader_program::save_binary(std::filesystem::path const& filename)
 {
-    GLint cur{ 0 };
-    GL_CHECK(glGetIntegerv(GL_CURRENT_PROGRAM, &cur));
-    GL_CHECK(glUseProgram(handle));
+    if (filename.empty()) return;
+
+    GLint length{ 0 };
+    GL_CHECK(glGetProgramiv(handle, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0) return;
 
-    return static_cast<handle_t>(cur);
+    binary_header header{};
+    std::vector<std::byte> file(sizeof(header) + static_cast<std::size_t>(length));
+    GL_CHECK(glGetProgramBinary(handle, length, nullptr, &header.format,
+                                file.data() + sizeof(header)));
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    save_file(filename, file);
 }
 
 void
-shader_program::unbind(std::any data)
+shader_program::reflect()
 {
-    GL_CHECK(glUseProgram(0));
-    GL_CHECK(glUseProgram(std::any_cast<handle_t>(data)));
+    reflect_uniforms();
+    reflect_attributes();
+    reflect_uniform_blocks();
+
+    for (auto* const table : { &uniform_names, &attribute_names, &uniform_block_names })
+    {
+        std::ranges::sort(*table, {}, &reflected::hash);
+        assert(std::ranges::adjacent_find(*table, {}, &reflected::hash) == table->end()
+               && "name hash collision");
+    }
 }
 
 void
-shader_program::uniform(uniform_location id, glm::vec3 const& vec)
+shader_program::reflect_uniforms()
+{
+    uniforms.clear();
+    uniform_values.clear();
+    uniform_names.clear();
+
+    GLint count{ 0 };
+    GL_CHECK(glGetProgramiv(handle, GL_ACTIVE_UNIFORMS, &count));
+    GLint max_name_len{ 0 };
+    GL_CHECK(glGetProgramiv(handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_len));
+
+    std::vector<GLchar> name(static_cast<std::size_t>(std::max(max_name_len, 1)));
+    for (GLuint i{ 0 }; i < static_cast<GLuint>(count); ++i)
+    {
+        GLsizei len{ 0 };
+        GLint elements{ 0 };
+        GLenum type{ 0 };
+        GL_CHECK(glGetActiveUniform(handle, i, static_cast<GLsizei>(name.size()), &len,
+                                    &elements, &type, name.data()));
+
+        // block members have no location
+        GLint const location{ glGetUniformLocation(handle, name.data()) };
+        if (location < 0) continue;
+
+        uniform_names.push_back(
+            { .hash = fnv1a(strip_array_suffix({ name.data(), static_cast<std::size_t>(len) })),
+              .value = static_cast<uint32_t>(location) });
+
+        uint32_t const size{ uniform_size(type) };
+        if (size == 0) continue;
+
+        // array elements have consecutive locations
+        for (GLint e{ 0 }; e < elements; ++e)
+        {
+            auto const loc{ static_cast<std::size_t>(location + e) };
+            if (loc >= uniforms.size()) uniforms.resize(loc + 1);
+
+            auto const offset{ static_cast<uint32_t>(uniform_values.size()) };
+            uniforms[loc] = { .size = size, .offset = offset };
+            uniform_values.resize(uniform_values.size() + size);
+        }
+    }
+}
+
+void
+shader_program::reflect_attributes()
+{
+    attribute_names.clear();
+
+    GLint count{ 0 };
+    GL_CHECK(glGetProgramiv(handle, GL_ACTIVE_ATTRIBUTES, &count));
+    GLint max_name_len{ 0 };
+    GL_CHECK(glGetProgramiv(handle, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_name_len));
+
+    std::vector<GLchar> name(static_cast<std::size_t>(std::max(max_name_len, 1)));
+    for (GLuint i{ 0 }; i < static_cast<GLuint>(count); ++i)
+    {
+        GLsizei len{ 0 };
+        GLint elements{ 0 };
+        GLenum type{ 0 };
+        GL_CHECK(glGetActiveAttrib(handle, i, static_cast<GLsizei>(name.size()), &len, &elements,
+                                   &type, name.data()));
+
+        // built-ins, e.g. gl_VertexID, have no location
+        GLint const location{ glGetAttribLocation(handle, name.data()) };
+        if (location < 0) continue;
+
+        attribute_names.push_back(
+            { .hash = fnv1a(strip_array_suffix({ name.data(), static_cast<std::size_t>(len) })),
+              .value = static_cast<uint32_t>(location) });
+    }
+}
+
+void
+shader_program::reflect_uniform_blocks()
+{
+    uniform_block_names.clear();
+
+    GLint count{ 0 };
+    GL_CHECK(glGetProgramiv(handle, GL_ACTIVE_UNIFORM_BLOCKS, &count));
+    GLint max_name_len{ 0 };
+    GL_CHECK(glGetProgramiv(handle, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_name_len));
+
+    std::vector<GLchar> name(static_cast<std::size_t>(std::max(max_name_len, 1)));
+    for (GLuint i{ 0 }; i < static_cast<GLuint>(count); ++i)
+    {
+        GLsizei len{ 0 };
+        GL_CHECK(glGetActiveUniformBlockName(handle, i, static_cast<GLsizei>(name.size()), &len,
+                                             name.data()));
+        GLint binding{ 0 };
+        GL_CHECK(glGetActiveUniformBlockiv(handle, i, GL_UNIFORM_BLOCK_BINDING, &binding));
+
+        uniform_block_names.push_back(
+            { .hash = fnv1a(strip_array_suffix({ name.data(), static_cast<std::size_t>(len) })),
+              .value = static_cast<uint32_t>(binding) });
+    }
+}
+
+std::optional<uint32_t>
+shader_program::find(reflection_table const& table, hashed_name name)
+{
+    auto const it = std::ranges::lower_bound(table, name.value, {}, &reflected::hash);
+    if (it == table.end() || it->hash != name.value) return std::nullopt;
+
+    return it->value;
+}
+
+std::optional<shader_program::uniform_location>
+shader_program::find_uniform(hashed_name name) const
+{
+    return find(uniform_names, name);
+}
+
+std::optional<uint32_t>
+shader_program::find_attribute(hashed_name name) const
+{
+    return find(attribute_names, name);
+}
+
+std::optional<uint32_t>
+shader_program::find_uniform_block(hashed_name name) const
+{
+    return find(uniform_block_names, name);
+}
+
+bool
+shader_program::is_cached(uniform_location id, std::span<std::byte const> value)
+{
+    auto& stats = ctx->frame_stats();
+
+    // not reflected or called with other type than declared, upload as is
+    if (id >= uniforms.size() || uniforms[id].size != value.size())
+    {
+        ++stats.uniform_uploads;
+        return false;
+    }
+
+    auto& u = uniforms[id];
+    auto const cached = std::span{ uniform_values }.subspan(u.offset, u.size);
+    if (u.is_set && std::ranges::equal(cached, value))
+    {
+        ++stats.elided_uniform_uploads;
+        return true;
+    }
+
+    std::ranges::copy(value, cached.begin());
+    u.is_set = true;
+    ++stats.uniform_uploads;
+
+    return false;
+}
+
+void
+shader_program::dispatch(glm::u32vec3 groups)
 {
     bind_guard _{ *this };
 
-    GL_CHECK(glUniform3f(id, vec.x, vec.y, vec.z));
+    GL_CHECK(glDispatchCompute(groups.x, groups.y, groups.z));
+}
+
+shader_program::bind_state_t
+shader_program::bind()
+{
+    return ctx->state().use_program(static_cast<gl_state::handle_t>(handle));
+}
+
+void
+shader_program::unbind(bind_state_t prev)
+{
+    ctx->state().use_program(prev);
+}
+
+void
+shader_program::uniform(uniform_location id, glm::vec3 const& vec)
+{
+    if (is_cached(id, vec)) return;
+
+    GL_CHECK(glProgramUniform3f(handle, id, vec.x, vec.y, vec.z));
 }
 
 void
 shader_program::uniform(uniform_location id, glm::vec4 const& vec)
 {
-    bind_guard _{ *this };
+    if (is_cached(id, vec)) return;
 
-    GL_CHECK(glUniform4f(id, vec.x, vec.y, vec.z, vec.w));
+    GL_CHECK(glProgramUniform4f(handle, id, vec.x, vec.y, vec.z, vec.w));
 }
 
 void
 shader_program::uniform(uniform_location id, glm::mat4 const& mat)
 {
-    bind_guard _{ *this };
+    if (is_cached(id, mat)) return;
 
-    GL_CHECK(glUniformMatrix4fv(id, 1, GL_FALSE, glm::value_ptr(mat)));
+    GL_CHECK(glProgramUniformMatrix4fv(handle, id, 1, GL_FALSE, glm::value_ptr(mat)));
 }
 
 void
 shader_program::uniform(uniform_location id, glm::mat3 const& mat)
 {
-    bind_guard _{ *this };
+    if (is_cached(id, mat)) return;
 
-    GL_CHECK(glUniformMatrix3fv(id, 1, GL_FALSE, glm::value_ptr(mat)));
+    GL_CHECK(glProgramUniformMatrix3fv(handle, id, 1, GL_FALSE, glm::value_ptr(mat)));
 }
 
 void
 shader_program::uniform(uniform_location id, float v)
 {
-    bind_guard _{ *this };
+    if (is_cached(id, v)) return;
+
+    GL_CHECK(glProgramUniform1f(handle, id, v));
+}
+
+void
+shader_program::uniform(uniform_location id, uint32_t v)
+{
+    if (is_cached(id, v)) return;
+
+    GL_CHECK(glProgramUniform1ui(handle, id, v));
+}
+
+void
+shader_program::uniform(uniform_location id, int32_t v)
+{
+    if (is_cached(id, v)) return;
 
-    GL_CHECK(glUniform1f(id, v));
+    GL_CHECK(glProgramUniform1i(handle, id, v));
 }
 
 } // namespace dg
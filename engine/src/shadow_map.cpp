@@ -0,0 +1,180 @@
+#include <engine/context.hpp>
+#include <engine/error.hpp>
+#include <engine/frustum.hpp>
+#include <engine/shadow_map.hpp>
+
+#include <glad/glad.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace dg
+{
+
+namespace
+{
+
+///! look direction and up vector of cube faces, as GL samples them
+struct face_axes
+{
+    glm::vec3 direction;
+    glm::vec3 up;
+};
+
+std::array<face_axes, 6> const faces{ face_axes{ { 1, 0, 0 }, { 0, -1, 0 } },
+                                      face_axes{ { -1, 0, 0 }, { 0, -1, 0 } },
+                                      face_axes{ { 0, 1, 0 }, { 0, 0, 1 } },
+                                      face_axes{ { 0, -1, 0 }, { 0, 0, -1 } },
+                                      face_axes{ { 0, 0, 1 }, { 0, -1, 0 } },
+                                      face_axes{ { 0, 0, -1 }, { 0, -1, 0 } } };
+
+} // namespace
+
+shadow_map::shadow_map(context& c, uint32_t size, float near_plane, float far_plane, float bias)
+    : ctx(c)
+    , program(depth_only_program(c))
+    , pipeline(c, pipeline_state::desc{ .program = &program })
+    , params_block(c, params_binding)
+    , z_near(near_plane)
+    , z_far(far_plane)
+    , depth_bias(bias)
+    , extent(size)
+    , static_map(c, texture::target_t::texture_cube_map, texture::format_t::depth24,
+                 glm::u32vec2{ size }, 1)
+    , sampled_map(c, texture::target_t::texture_cube_map, texture::format_t::depth24,
+                  glm::u32vec2{ size }, 1)
+    , render_target(c)
+{
+    assert(near_plane > 0.0f && near_plane < far_plane);
+
+    render_target.draw_buffers(0);
+    render_target.attach(static_map, 0);
+    render_target.validate("shadow map");
+}
+
+void
+shadow_map::update(glm::vec3 const& light_position, std::span<caster const> static_casters,
+                   std::span<caster const> dynamic_casters)
+{
+    if (!is_light_known || light_position != cached_light)
+    {
+        is_face_cached.fill(false);
+        is_light_known = true;
+        cached_light = light_position;
+
+        glm::mat4 const projection = glm::perspective(glm::radians(90.0f), 1.0f, z_near, z_far);
+        for (uint32_t face{ 0 }; face < 6; ++face)
+        {
+            glm::vec3 const target{ light_position + faces[face].direction };
+            view_projs[face] = projection * glm::lookAt(light_position, target, faces[face].up);
+        }
+        params_block.update({ .light = glm::vec4{ light_position, 1.0f },
+                              .depth = { z_near, z_far, depth_bias, 0.0f } });
+    }
+
+    // a moved caster leaves stale depth where it was and is missing where it is now
+    if (static_casters.size() != cached_casters.size())
+    {
+        is_face_cached.fill(false);
+    } else
+    {
+        for (std::size_t i{ 0 }; i < static_casters.size(); ++i)
+        {
+            if (static_casters[i].mesh == cached_casters[i].mesh) continue;
+
+            invalidate_faces(cached_casters[i].bounds);
+            invalidate_faces(static_casters[i].bounds);
+        }
+    }
+    cached_casters.assign(static_casters.begin(), static_casters.end());
+
+    std::array<GLint, 4> prev_viewport{};
+    GL_CHECK(glGetIntegerv(GL_VIEWPORT, prev_viewport.data()));
+    auto const prev_framebuffer = render_target.bind();
+    GL_CHECK(glViewport(0, 0, static_cast<GLsizei>(extent), static_cast<GLsizei>(extent)));
+    pipeline.apply();
+
+    auto& stats = ctx.frame_stats();
+    for (uint32_t face{ 0 }; face < 6; ++face)
+    {
+        frustum const f{ frustum::from_matrix(view_projs[face]) };
+        bool const has_dynamic = std::ranges::any_of(
+            dynamic_casters,
+            [&f](caster const& c) { return f.intersects_aabb(c.bounds.min, c.bounds.max); });
+        bool const is_static_hit{ is_face_cached[face] };
+
+        if (is_static_hit)
+        {
+            ++stats.shadow_cache_hits;
+        } else
+        {
+            ++stats.shadow_cache_misses;
+            render_target.attach(static_map, face);
+            GLfloat const clear_depth{ 1.0f };
+            GL_CHECK(glClearBufferfv(GL_DEPTH, 0, &clear_depth));
+            draw(face, static_casters);
+            is_face_cached[face] = true;
+        }
+
+        // sampled face already equals the cache unless it changed or dynamic casters were drawn
+        // over it, now or last time
+        if (is_static_hit && !has_dynamic && !has_face_dynamic[face]) continue;
+
+        static_map.copy_to(sampled_map, face);
+        if (has_dynamic)
+        {
+            render_target.attach(sampled_map, face);
+            draw(face, dynamic_casters);
+        }
+        has_face_dynamic[face] = has_dynamic;
+    }
+
+    render_target.unbind(prev_framebuffer);
+    GL_CHECK(glViewport(prev_viewport[0], prev_viewport[1], prev_viewport[2], prev_viewport[3]));
+    sampled_map.bind_unit(texture_unit);
+}
+
+void
+shadow_map::invalidate()
+{
+    is_face_cached.fill(false);
+}
+
+glm::mat4 const&
+shadow_map::face_view_proj(uint32_t face) const
+{
+    assert(face < 6);
+
+    return view_projs[face];
+}
+
+void
+shadow_map::invalidate_faces(aabb const& box)
+{
+    for (uint32_t face{ 0 }; face < 6; ++face)
+    {
+        if (frustum::from_matrix(view_projs[face]).intersects_aabb(box.min, box.max))
+        {
+            is_face_cached[face] = false;
+        }
+    }
+}
+
+void
+shadow_map::draw(uint32_t face, std::span<caster const> casters)
+{
+    frustum const f{ frustum::from_matrix(view_projs[face]) };
+    uint64_t drawn{ 0 };
+    for (auto const& c : casters)
+    {
+        if (!f.intersects_aabb(c.bounds.min, c.bounds.max)) continue;
+
+        c.mesh.draw(program, view_projs[face]);
+        ++drawn;
+    }
+    ctx.frame_stats().draw_calls += drawn;
+}
+
+} // namespace dg
@@ -0,0 +1,3 @@
+// the only translation unit with stb_image implementation, tinygltf uses it too
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
@@ -0,0 +1,403 @@
+#include <engine/bind_guard.hpp>
+#include <engine/context.hpp>
+#include <engine/deletion_queue.hpp>
+#include <engine/error.hpp>
+#include <engine/gl_state.hpp>
+#include <engine/texture.hpp>
+#include <engine/util.hpp>
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace dg
+{
+
+namespace
+{
+
+GLenum
+gl_target(texture::target_t target)
+{
+    switch (target)
+    {
+    case texture::target_t::texture_2d:
+        return GL_TEXTURE_2D;
+    case texture::target_t::texture_2d_array:
+        return GL_TEXTURE_2D_ARRAY;
+    case texture::target_t::texture_cube_map:
+        return GL_TEXTURE_CUBE_MAP;
+    }
+
+    unreachable();
+}
+
+///! target of a single 2D image, cube map faces are separate targets
+GLenum
+gl_image_target(texture::target_t target, uint32_t layer)
+{
+    if (target == texture::target_t::texture_cube_map)
+    {
+        return GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer;
+    }
+
+    return gl_target(target);
+}
+
+GLenum
+gl_internal_format(texture::format_t format)
+{
+    switch (format)
+    {
+    case texture::format_t::rgba8:
+        return GL_RGBA8;
+    case texture::format_t::srgb8_alpha8:
+        return GL_SRGB8_ALPHA8;
+    case texture::format_t::etc2_rgb8:
+        return GL_COMPRESSED_RGB8_ETC2;
+    case texture::format_t::etc2_rgba8:
+        return GL_COMPRESSED_RGBA8_ETC2_EAC;
+    case texture::format_t::astc_4x4:
+        return GL_COMPRESSED_RGBA_ASTC_4x4;
+    case texture::format_t::astc_6x6:
+        return GL_COMPRESSED_RGBA_ASTC_6x6;
+    case texture::format_t::astc_8x8:
+        return GL_COMPRESSED_RGBA_ASTC_8x8;
+    case texture::format_t::depth24:
+        return GL_DEPTH_COMPONENT24;
+    case texture::format_t::r32ui:
+        return GL_R32UI;
+    case texture::format_t::rg16ui:
+        return GL_RG16UI;
+    }
+
+    unreachable();
+}
+
+struct block_info
+{
+    glm::u32vec2 extent;
+    std::size_t bytes;
+};
+
+block_info
+block(texture::format_t format)
+{
+    switch (format)
+    {
+    case texture::format_t::rgba8:
+    case texture::format_t::srgb8_alpha8:
+    case texture::format_t::depth24:
+    case texture::format_t::r32ui:
+    case texture::format_t::rg16ui:
+        return { { 1, 1 }, 4 };
+    case texture::format_t::etc2_rgb8:
+        return { { 4, 4 }, 8 };
+    case texture::format_t::etc2_rgba8:
+    case texture::format_t::astc_4x4:
+        return { { 4, 4 }, 16 };
+    case texture::format_t::astc_6x6:
+        return { { 6, 6 }, 16 };
+    case texture::format_t::astc_8x8:
+        return { { 8, 8 }, 16 };
+    }
+
+    unreachable();
+}
+
+glm::u32vec2
+level_extent(glm::u32vec2 size, uint32_t level)
+{
+    return { std::max(1u, size.x >> level), std::max(1u, size.y >> level) };
+}
+
+} // namespace
+
+texture::error::error(std::string const& msg)
+    : std::runtime_error(msg)
+{
+}
+
+texture::error::error(char const* msg)
+    : std::runtime_error(msg)
+{
+}
+
+bool
+texture::is_compressed(format_t format)
+{
+    return format != format_t::rgba8 && format != format_t::srgb8_alpha8
+           && format != format_t::depth24 && format != format_t::r32ui
+           && format != format_t::rg16ui;
+}
+
+std::size_t
+texture::level_size(format_t format, glm::u32vec2 size, uint32_t level)
+{
+    auto const [extent, bytes] = block(format);
+    glm::u32vec2 const s = level_extent(size, level);
+
+    return std::size_t{ (s.x + extent.x - 1) / extent.x } * ((s.y + extent.y - 1) / extent.y) * bytes;
+}
+
+texture::texture(context& c, target_t t, format_t format, glm::u32vec2 size, uint32_t levels,
+                 uint32_t layers)
+    : ctx(&c)
+    , target(t)
+    , fmt(format)
+    , extent(size)
+    , level_count(levels)
+    , layer_count(t == target_t::texture_2d_array   ? layers
+                  : t == target_t::texture_cube_map ? 6
+                                                    : 1)
+{
+    assert(levels > 0 && size.x > 0 && size.y > 0);
+
+    GL_CHECK(glGenTextures(1, &handle));
+    if (handle == 0)
+    {
+        throw error("error occurs creating texture");
+    }
+
+    bind_guard _{ *this };
+
+    GLenum const gl_t = gl_target(target);
+    auto const w = static_cast<GLsizei>(size.x);
+    auto const h = static_cast<GLsizei>(size.y);
+    auto const l = static_cast<GLsizei>(levels);
+
+    if (target == target_t::texture_2d_array)
+    {
+        GL_CHECK(glTexStorage3D(gl_t, l, gl_internal_format(fmt), w, h, static_cast<GLsizei>(layer_count)));
+    } else
+    {
+        GL_CHECK(glTexStorage2D(gl_t, l, gl_internal_format(fmt), w, h));
+    }
+
+    // integer textures are incomplete unless filtered as nearest
+    bool const is_integer{ fmt == format_t::r32ui || fmt == format_t::rg16ui };
+    GLint const min_filter = is_integer ? (levels > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST)
+                                        : (levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    GL_CHECK(glTexParameteri(gl_t, GL_TEXTURE_MIN_FILTER, min_filter));
+    GL_CHECK(glTexParameteri(gl_t, GL_TEXTURE_MAG_FILTER, is_integer ? GL_NEAREST : GL_LINEAR));
+    bool const is_clamped{ fmt == format_t::depth24 || target == target_t::texture_cube_map };
+    GLint const wrap = is_clamped ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+    GL_CHECK(glTexParameteri(gl_t, GL_TEXTURE_WRAP_S, wrap));
+    GL_CHECK(glTexParameteri(gl_t, GL_TEXTURE_WRAP_T, wrap));
+    GL_CHECK(glTexParameteri(gl_t, GL_TEXTURE_MAX_LEVEL, l - 1));
+    if (fmt == format_t::depth24)
+    {
+        GL_CHECK(glTexParameteri(gl_t, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL));
+        depth_compare(true);
+    }
+}
+
+texture::texture(texture&& other)
+    : ctx(other.ctx)
+    , handle(other.handle)
+    , target(other.target)
+    , fmt(other.fmt)
+    , extent(other.extent)
+    , level_count(other.level_count)
+    , layer_count(other.layer_count)
+{
+    other.handle = 0;
+}
+
+texture&
+texture::operator=(texture other)
+{
+    using std::swap;
+
+    swap(ctx, other.ctx);
+    swap(handle, other.handle);
+    swap(target, other.target);
+    swap(fmt, other.fmt);
+    swap(extent, other.extent);
+    swap(level_count, other.level_count);
+    swap(layer_count, other.layer_count);
+
+    return *this;
+}
+
+texture::~texture()
+{
+    if (ctx) ctx->deletions().push(deletion_queue::object_t::texture, handle);
+}
+
+void
+texture::upload(uint32_t level, uint32_t layer, std::span<std::byte const> data)
+{
+    assert(level < level_count && layer < layer_count);
+    assert(data.size() == level_size(fmt, extent, level));
+
+    bind_guard _{ *this };
+
+    GLenum const gl_t = gl_target(target);
+    glm::u32vec2 const s = level_extent(extent, level);
+    auto const w = static_cast<GLsizei>(s.x);
+    auto const h = static_cast<GLsizei>(s.y);
+    auto const l = static_cast<GLint>(level);
+    auto const z = static_cast<GLint>(layer);
+    auto const bytes = static_cast<GLsizei>(data.size());
+
+    if (is_compressed(fmt))
+    {
+        if (target == target_t::texture_2d_array)
+        {
+            GL_CHECK(glCompressedTexSubImage3D(gl_t, l, 0, 0, z, w, h, 1, gl_internal_format(fmt), bytes,
+                                               data.data()));
+        } else
+        {
+            GL_CHECK(glCompressedTexSubImage2D(gl_image_target(target, layer), l, 0, 0, w, h,
+                                               gl_internal_format(fmt), bytes, data.data()));
+        }
+    } else
+    {
+        // clang-format off
+        GLenum const pixel_format = fmt == format_t::depth24 ? GL_DEPTH_COMPONENT
+                                  : fmt == format_t::r32ui   ? GL_RED_INTEGER
+                                  : fmt == format_t::rg16ui  ? GL_RG_INTEGER
+                                  : GL_RGBA;
+        GLenum const pixel_type = fmt == format_t::depth24 ? GL_UNSIGNED_INT
+                                : fmt == format_t::r32ui   ? GL_UNSIGNED_INT
+                                : fmt == format_t::rg16ui  ? GL_UNSIGNED_SHORT
+                                : GL_UNSIGNED_BYTE;
+        // clang-format on
+        if (target == target_t::texture_2d_array)
+        {
+            GL_CHECK(glTexSubImage3D(gl_t, l, 0, 0, z, w, h, 1, pixel_format, pixel_type, data.data()));
+        } else
+        {
+            GL_CHECK(glTexSubImage2D(gl_image_target(target, layer), l, 0, 0, w, h, pixel_format,
+                                     pixel_type, data.data()));
+        }
+    }
+}
+
+void
+texture::base_level(uint32_t level)
+{
+    assert(level < level_count);
+
+    bind_guard _{ *this };
+
+    GL_CHECK(glTexParameteri(gl_target(target), GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(level)));
+}
+
+void
+texture::bind_unit(uint32_t unit)
+{
+    ctx->state().bind_texture(unit, target, handle);
+}
+
+void
+texture::depth_compare(bool is_enabled)
+{
+    assert(fmt == format_t::depth24);
+
+    bind_guard _{ *this };
+
+    // linear filter of compared values gives 2x2 PCF on most hardware
+    GLenum const gl_t = gl_target(target);
+    bool const is_mipmapped{ level_count > 1 };
+    GLint const min_filter = is_enabled ? (is_mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR)
+                                        : (is_mipmapped ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+    GLint const mode = is_enabled ? GL_COMPARE_REF_TO_TEXTURE : GL_NONE;
+    GL_CHECK(glTexParameteri(gl_t, GL_TEXTURE_COMPARE_MODE, mode));
+    GL_CHECK(glTexParameteri(gl_t, GL_TEXTURE_MIN_FILTER, min_filter));
+    GL_CHECK(glTexParameteri(gl_t, GL_TEXTURE_MAG_FILTER, is_enabled ? GL_LINEAR : GL_NEAREST));
+}
+
+void
+texture::attach(uint32_t layer, uint32_t color_index)
+{
+    assert(layer < layer_count);
+
+    GLenum const attachment = fmt == format_t::depth24 ? GL_DEPTH_ATTACHMENT
+                                                       : GL_COLOR_ATTACHMENT0 + color_index;
+    if (target == target_t::texture_2d_array)
+    {
+        GL_CHECK(glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, handle, 0,
+                                           static_cast<GLint>(layer)));
+    } else
+    {
+        GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, gl_image_target(target, layer),
+                                        handle, 0));
+    }
+}
+
+void
+texture::copy_to(texture& dst) const
+{
+    assert(dst.fmt == fmt && dst.extent == extent && dst.target == target);
+    assert(dst.level_count >= level_count && dst.layer_count == layer_count);
+
+    GLenum const gl_t = gl_target(target);
+    for (uint32_t level{ 0 }; level < level_count; ++level)
+    {
+        glm::u32vec2 const s = level_extent(extent, level);
+        GL_CHECK(glCopyImageSubData(handle, gl_t, static_cast<GLint>(level), 0, 0, 0, dst.handle,
+                                    gl_t, static_cast<GLint>(level), 0, 0, 0,
+                                    static_cast<GLsizei>(s.x), static_cast<GLsizei>(s.y),
+                                    static_cast<GLsizei>(layer_count)));
+    }
+}
+
+void
+texture::copy_to(texture& dst, uint32_t layer) const
+{
+    assert(dst.fmt == fmt && dst.extent == extent && dst.target == target);
+    assert(dst.level_count >= level_count && layer < layer_count && layer < dst.layer_count);
+
+    GLenum const gl_t = gl_target(target);
+    auto const z{ static_cast<GLint>(layer) };
+    for (uint32_t level{ 0 }; level < level_count; ++level)
+    {
+        glm::u32vec2 const s = level_extent(extent, level);
+        GL_CHECK(glCopyImageSubData(handle, gl_t, static_cast<GLint>(level), 0, 0, z, dst.handle,
+                                    gl_t, static_cast<GLint>(level), 0, 0, z,
+                                    static_cast<GLsizei>(s.x), static_cast<GLsizei>(s.y), 1));
+    }
+}
+
+glm::u32vec2
+texture::size() const
+{
+    return extent;
+}
+
+uint32_t
+texture::levels() const
+{
+    return level_count;
+}
+
+uint32_t
+texture::layers() const
+{
+    return layer_count;
+}
+
+texture::format_t
+texture::format() const
+{
+    return fmt;
+}
+
+texture::bind_state_t
+texture::bind()
+{
+    auto& state = ctx->state();
+    return state.bind_texture(state.active_texture_unit(), target, handle);
+}
+
+void
+texture::unbind(bind_state_t prev)
+{
+    auto& state = ctx->state();
+    state.bind_texture(state.active_texture_unit(), target, prev);
+}
+
+} // namespace dg
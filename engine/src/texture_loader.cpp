@@ -0,0 +1,206 @@
+#include <engine/error.hpp>
+#include <engine/texture_loader.hpp>
+#include <engine/util.hpp>
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stb_image.h>
+
+namespace dg
+{
+
+namespace
+{
+
+std::vector<std::byte>
+downsample(std::vector<std::byte> const& src, glm::u32vec2 src_size, glm::u32vec2 dst_size)
+{
+    uint32_t const channels{ 4 };
+    std::vector<std::byte> dst(std::size_t{ dst_size.x } * dst_size.y * channels);
+
+    for (uint32_t y{ 0 }; y < dst_size.y; ++y)
+    {
+        uint32_t const y0{ std::min(y * 2, src_size.y - 1) };
+        uint32_t const y1{ std::min(y * 2 + 1, src_size.y - 1) };
+
+        for (uint32_t x{ 0 }; x < dst_size.x; ++x)
+        {
+            uint32_t const x0{ std::min(x * 2, src_size.x - 1) };
+            uint32_t const x1{ std::min(x * 2 + 1, src_size.x - 1) };
+
+            for (uint32_t c{ 0 }; c < channels; ++c)
+            {
+                auto const at = [&](uint32_t px, uint32_t py)
+                { return std::to_integer<uint32_t>(src[(std::size_t{ py } * src_size.x + px) * channels + c]); };
+
+                uint32_t const sum{ at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1) };
+                dst[(std::size_t{ y } * dst_size.x + x) * channels + c] = static_cast<std::byte>((sum + 2) / 4);
+            }
+        }
+    }
+
+    return dst;
+}
+
+std::optional<image>
+decode_raster(std::span<std::byte const> data, std::string const& name)
+{
+    int w{ 0 }, h{ 0 }, channels{ 0 };
+    stbi_uc* const pixels = stbi_load_from_memory(reinterpret_cast<stbi_uc const*>(data.data()),
+                                                  static_cast<int>(data.size()), &w, &h, &channels, 4);
+    if (nullptr == pixels)
+    {
+        LOG_DEBUG("error occurs decoding image %s: %s", name.c_str(), stbi_failure_reason());
+        return std::nullopt;
+    }
+
+    image res{ .format = texture::format_t::rgba8, .size = { w, h } };
+
+    auto const* const begin = reinterpret_cast<std::byte const*>(pixels);
+    res.levels.emplace_back(begin, begin + std::size_t{ res.size.x } * res.size.y * 4);
+    stbi_image_free(pixels);
+
+    glm::u32vec2 size{ res.size };
+    while (size.x > 1 || size.y > 1)
+    {
+        glm::u32vec2 const next{ std::max(1u, size.x / 2), std::max(1u, size.y / 2) };
+        res.levels.push_back(downsample(res.levels.back(), size, next));
+        size = next;
+    }
+
+    return res;
+}
+
+std::optional<texture::format_t>
+from_gl_format(uint32_t internal_format)
+{
+    switch (internal_format)
+    {
+    case GL_RGBA8:
+        return texture::format_t::rgba8;
+    case GL_SRGB8_ALPHA8:
+        return texture::format_t::srgb8_alpha8;
+    case GL_COMPRESSED_RGB8_ETC2:
+        return texture::format_t::etc2_rgb8;
+    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+        return texture::format_t::etc2_rgba8;
+    case GL_COMPRESSED_RGBA_ASTC_4x4:
+        return texture::format_t::astc_4x4;
+    case GL_COMPRESSED_RGBA_ASTC_6x6:
+        return texture::format_t::astc_6x6;
+    case GL_COMPRESSED_RGBA_ASTC_8x8:
+        return texture::format_t::astc_8x8;
+    }
+
+    return std::nullopt;
+}
+
+// https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html
+std::optional<image>
+decode_ktx(std::span<std::byte const> data, std::string const& name)
+{
+    constexpr std::array<uint8_t, 12> identifier{ 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31,
+                                                  0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+    struct header
+    {
+        uint32_t endianness;
+        uint32_t gl_type;
+        uint32_t gl_type_size;
+        uint32_t gl_format;
+        uint32_t gl_internal_format;
+        uint32_t gl_base_internal_format;
+        uint32_t pixel_width;
+        uint32_t pixel_height;
+        uint32_t pixel_depth;
+        uint32_t array_elements;
+        uint32_t faces;
+        uint32_t mip_levels;
+        uint32_t key_value_bytes;
+    };
+
+    header h{};
+    if (data.size() < identifier.size() + sizeof(h) ||
+        0 != std::memcmp(data.data(), identifier.data(), identifier.size()))
+    {
+        LOG_DEBUG("%s isn't KTX 1.1 file", name.c_str());
+        return std::nullopt;
+    }
+    std::memcpy(&h, data.data() + identifier.size(), sizeof(h));
+
+    if (h.endianness != 0x04030201)
+    {
+        LOG_DEBUG("%s: KTX with foreign endianness isn't supported", name.c_str());
+        return std::nullopt;
+    }
+    if (h.pixel_depth > 1 || h.array_elements > 0 || h.faces != 1)
+    {
+        LOG_DEBUG("%s: only 2D KTX textures are supported", name.c_str());
+        return std::nullopt;
+    }
+
+    auto const format = from_gl_format(h.gl_internal_format);
+    if (!format.has_value())
+    {
+        LOG_DEBUG("%s: unsupported KTX internal format 0x%x", name.c_str(), h.gl_internal_format);
+        return std::nullopt;
+    }
+
+    image res{ .format = *format, .size = { h.pixel_width, h.pixel_height } };
+
+    std::size_t offset{ identifier.size() + sizeof(h) + h.key_value_bytes };
+    uint32_t const levels{ std::max(1u, h.mip_levels) };
+    for (uint32_t level{ 0 }; level < levels; ++level)
+    {
+        uint32_t level_bytes{ 0 };
+        if (offset + sizeof(level_bytes) > data.size()) break;
+        std::memcpy(&level_bytes, data.data() + offset, sizeof(level_bytes));
+        offset += sizeof(level_bytes);
+
+        if (offset + level_bytes > data.size() || level_bytes != texture::level_size(res.format, res.size, level))
+        {
+            LOG_DEBUG("%s: corrupted KTX mip level %u", name.c_str(), level);
+            break;
+        }
+
+        auto const* const begin = data.data() + offset;
+        res.levels.emplace_back(begin, begin + level_bytes);
+
+        // mip padding
+        offset += (level_bytes + 3u) & ~3u;
+    }
+
+    if (res.levels.empty()) return std::nullopt;
+
+    return res;
+}
+
+} // namespace
+
+std::optional<image>
+load(image_t type, std::filesystem::path const& filename)
+{
+    auto const data{ load_file(filename) };
+    if (data.empty()) return std::nullopt;
+
+    return decode(type, data, filename.string());
+}
+
+std::optional<image>
+decode(image_t type, std::span<std::byte const> data, std::string const& name)
+{
+    switch (type)
+    {
+    case image_t::raster:
+        return decode_raster(data, name);
+
+    case image_t::ktx:
+        return decode_ktx(data, name);
+    }
+
+    unreachable();
+}
+
+} // namespace dg
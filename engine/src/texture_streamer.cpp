@@ -0,0 +1,164 @@
+#include <engine/error.hpp>
+#include <engine/texture_streamer.hpp>
+#include <engine/thread_pool.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace dg
+{
+
+texture_streamer::texture_streamer(context& c, thread_pool& p)
+    : ctx(c)
+    , pool(p)
+{
+}
+
+// in-flight requests are kept alive by jobs, so it is safe to leave them running
+texture_streamer::~texture_streamer() = default;
+
+texture_streamer::id
+texture_streamer::load(image_t type, std::filesystem::path const& filename)
+{
+    auto r = std::make_shared<request>();
+    r->type = type;
+    r->target = texture::target_t::texture_2d;
+    r->filenames.push_back(filename);
+
+    return enqueue(std::move(r));
+}
+
+texture_streamer::id
+texture_streamer::load_array(image_t type, std::vector<std::filesystem::path> filenames)
+{
+    auto r = std::make_shared<request>();
+    r->type = type;
+    r->target = texture::target_t::texture_2d_array;
+    r->filenames = std::move(filenames);
+
+    return enqueue(std::move(r));
+}
+
+texture_streamer::id
+texture_streamer::enqueue(std::shared_ptr<request> r)
+{
+    pool.submit([r] { decode(*r); });
+    requests.push_back(std::move(r));
+
+    return static_cast<id>(requests.size() - 1);
+}
+
+void
+texture_streamer::decode(request& r)
+{
+    for (auto const& filename : r.filenames)
+    {
+        auto img = dg::load(r.type, filename);
+        if (!img.has_value())
+        {
+            r.is_failed = true;
+            break;
+        }
+
+        if (!r.layers.empty())
+        {
+            auto const& first = r.layers.front();
+            if (first.format != img->format || first.size != img->size || first.levels.size() != img->levels.size())
+            {
+                LOG_DEBUG("texture array layer %s doesn't match first layer", filename.string().c_str());
+                r.is_failed = true;
+                break;
+            }
+        }
+
+        r.layers.push_back(std::move(*img));
+    }
+
+    r.is_decoded.store(true, std::memory_order_release);
+}
+
+bool
+texture_streamer::allocate(request& r)
+{
+    if (r.is_failed || r.layers.empty())
+    {
+        r.is_failed = true;
+        r.layers.clear();
+        return false;
+    }
+
+    auto const& first = r.layers.front();
+    auto const levels = static_cast<uint32_t>(first.levels.size());
+    r.tex.emplace(ctx, r.target, first.format, first.size, levels, static_cast<uint32_t>(r.layers.size()));
+    r.next_level = static_cast<int32_t>(levels) - 1;
+
+    return true;
+}
+
+void
+texture_streamer::pump(std::size_t budget)
+{
+    std::size_t spent{ 0 };
+    bool is_progressed{ false };
+
+    for (auto& r : requests)
+    {
+        if (r->next_level < 0 && r->tex.has_value()) continue;
+        if (!r->is_decoded.load(std::memory_order_acquire) || r->is_failed) continue;
+
+        if (!r->tex.has_value() && !allocate(*r)) continue;
+
+        while (r->next_level >= 0)
+        {
+            auto const level = static_cast<uint32_t>(r->next_level);
+            std::size_t const bytes{ texture::level_size(r->tex->format(), r->tex->size(), level) * r->layers.size() };
+            if (is_progressed && spent + bytes > budget) return;
+
+            for (uint32_t layer{ 0 }; layer < r->layers.size(); ++layer)
+            {
+                r->tex->upload(level, layer, r->layers[layer].levels[level]);
+
+                // uploaded data isn't needed anymore
+                std::vector<std::byte>{}.swap(r->layers[layer].levels[level]);
+            }
+            r->tex->base_level(level);
+
+            spent += bytes;
+            is_progressed = true;
+            --r->next_level;
+        }
+
+        r->layers.clear();
+    }
+}
+
+texture*
+texture_streamer::get(id i)
+{
+    assert(i < requests.size());
+
+    auto& r = *requests[i];
+    if (!r.tex.has_value() || r.next_level + 1 >= static_cast<int32_t>(r.tex->levels())) return nullptr;
+
+    return &r.tex.value();
+}
+
+bool
+texture_streamer::is_complete(id i) const
+{
+    assert(i < requests.size());
+
+    auto const& r = *requests[i];
+    return r.tex.has_value() && r.next_level < 0;
+}
+
+bool
+texture_streamer::is_failed(id i) const
+{
+    assert(i < requests.size());
+
+    auto const& r = *requests[i];
+    return r.is_decoded.load(std::memory_order_acquire) && r.is_failed;
+}
+
+} // namespace dg
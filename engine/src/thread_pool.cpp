@@ -0,0 +1,135 @@
+#include <engine/thread_pool.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <latch>
+
+namespace dg
+{
+
+namespace
+{
+
+// submitted chunks reference the caller's stack, so it must not unwind before they're done
+struct wait_guard
+{
+    std::latch& done;
+    ///! chunks that never made it into the queue, e.g. when `submit` threw
+    std::ptrdiff_t unsubmitted;
+
+    ~wait_guard()
+    {
+        if (unsubmitted > 0) done.count_down(unsubmitted);
+        done.wait();
+    }
+};
+
+} // namespace
+
+thread_pool::thread_pool(std::size_t threads)
+{
+    workers.reserve(threads);
+    for (std::size_t i{ 0 }; i < threads; ++i)
+    {
+        workers.emplace_back([this](std::stop_token token) { run(token); });
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    for (auto& w : workers)
+    {
+        w.request_stop();
+    }
+    cv.notify_all();
+}
+
+std::size_t
+thread_pool::default_size()
+{
+    std::size_t const hw{ std::thread::hardware_concurrency() };
+    return hw > 1 ? hw - 1 : 1;
+}
+
+void
+thread_pool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard _{ mutex };
+        jobs.push_back(std::move(job));
+    }
+    cv.notify_one();
+}
+
+void
+thread_pool::parallel_for(std::size_t count, std::function<void(std::size_t, std::size_t)> const& fn,
+                          std::size_t min_chunk)
+{
+    if (count == 0) return;
+
+    min_chunk = std::max<std::size_t>(min_chunk, 1);
+    std::size_t const max_chunks{ (count + min_chunk - 1) / min_chunk };
+    std::size_t const chunks{ std::min(workers.size() + 1, max_chunks) };
+    std::size_t const chunk_size{ (count + chunks - 1) / chunks };
+
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto const run_chunk = [&fn, &error_mutex, &error](std::size_t begin, std::size_t end)
+    {
+        try
+        {
+            if (begin < end) fn(begin, end);
+        }
+        catch (...)
+        {
+            std::lock_guard _{ error_mutex };
+            if (!error) error = std::current_exception();
+        }
+    };
+
+    std::latch done{ static_cast<std::ptrdiff_t>(chunks - 1) };
+    {
+        wait_guard guard{ done, static_cast<std::ptrdiff_t>(chunks - 1) };
+        for (std::size_t i{ 1 }; i < chunks; ++i)
+        {
+            std::size_t const begin{ i * chunk_size };
+            std::size_t const end{ std::min(count, begin + chunk_size) };
+            submit([&run_chunk, &done, begin, end]
+            {
+                run_chunk(begin, end);
+                done.count_down();
+            });
+            --guard.unsubmitted;
+        }
+
+        run_chunk(0, std::min(count, chunk_size));
+    }
+
+    if (error) std::rethrow_exception(error);
+}
+
+std::size_t
+thread_pool::size() const
+{
+    return workers.size();
+}
+
+void
+thread_pool::run(std::stop_token token)
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock lock{ mutex };
+            if (!cv.wait(lock, token, [this] { return !jobs.empty(); })) return;
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        job();
+    }
+}
+
+} // namespace dg
@@ -0,0 +1,5 @@
+// the only translation unit with tinygltf implementation, stb_image one is in stb_image.cpp.
+// glTF files are only read, so image writing is left out
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#include <tiny_gltf.h>
@@ -0,0 +1,323 @@
+#include <engine/transform_hierarchy.hpp>
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define DG_TRANSFORM_SSE 1
+#endif
+
+namespace dg
+{
+
+namespace
+{
+
+using node_span = std::span<transform_hierarchy::node_id const>;
+
+///! translate * rotate * scale without general matrix products
+glm::mat4
+compose(glm::vec3 const& t, glm::quat const& r, glm::vec3 const& s)
+{
+    glm::mat3 const rot{ glm::mat3_cast(r) };
+
+    return { glm::vec4{ rot[0] * s.x, 0.0f }, glm::vec4{ rot[1] * s.y, 0.0f },
+             glm::vec4{ rot[2] * s.z, 0.0f }, glm::vec4{ t, 1.0f } };
+}
+
+#if defined(DG_TRANSFORM_SSE)
+
+///! one component of four nodes, `ids[k..k + 4)`, in lanes
+template <class F>
+__m128
+gather(node_span ids, std::size_t k, F&& component)
+{
+    return _mm_setr_ps(component(ids[k]), component(ids[k + 1]), component(ids[k + 2]),
+                       component(ids[k + 3]));
+}
+
+///! `a x b` of xyz lanes, w lane is garbage
+__m128
+cross(__m128 a, __m128 b)
+{
+    __m128 const a_yzx{ _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)) };
+    __m128 const b_yzx{ _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1)) };
+    __m128 const c{ _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b)) };
+
+    return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+#endif
+
+///! local matrices of `ids` into `locals`. Four nodes are composed at once: their TRS are
+///! gathered so each register holds one component of four nodes, quaternion expansion and
+///! scaling run on whole registers and columns are transposed back on store
+void
+compose(std::span<glm::vec3 const> translations, std::span<glm::quat const> rotations,
+        std::span<glm::vec3 const> scales, node_span ids, std::span<glm::mat4> locals)
+{
+    std::size_t k{ 0 };
+#if defined(DG_TRANSFORM_SSE)
+    __m128 const one{ _mm_set1_ps(1.0f) };
+    __m128 const two{ _mm_set1_ps(2.0f) };
+    __m128 const zero{ _mm_setzero_ps() };
+    for (; k + 4 <= ids.size(); k += 4)
+    {
+        using id_t = transform_hierarchy::node_id;
+        __m128 const qx{ gather(ids, k, [&](id_t i) { return rotations[i].x; }) };
+        __m128 const qy{ gather(ids, k, [&](id_t i) { return rotations[i].y; }) };
+        __m128 const qz{ gather(ids, k, [&](id_t i) { return rotations[i].z; }) };
+        __m128 const qw{ gather(ids, k, [&](id_t i) { return rotations[i].w; }) };
+        __m128 const sx{ gather(ids, k, [&](id_t i) { return scales[i].x; }) };
+        __m128 const sy{ gather(ids, k, [&](id_t i) { return scales[i].y; }) };
+        __m128 const sz{ gather(ids, k, [&](id_t i) { return scales[i].z; }) };
+        __m128 tx{ gather(ids, k, [&](id_t i) { return translations[i].x; }) };
+        __m128 ty{ gather(ids, k, [&](id_t i) { return translations[i].y; }) };
+        __m128 tz{ gather(ids, k, [&](id_t i) { return translations[i].z; }) };
+        __m128 tw{ one };
+
+        // same expansion as `glm::mat3_cast`, products are doubled once
+        __m128 const x2{ _mm_mul_ps(qx, two) };
+        __m128 const y2{ _mm_mul_ps(qy, two) };
+        __m128 const z2{ _mm_mul_ps(qz, two) };
+        __m128 const xx{ _mm_mul_ps(qx, x2) };
+        __m128 const yy{ _mm_mul_ps(qy, y2) };
+        __m128 const zz{ _mm_mul_ps(qz, z2) };
+        __m128 const xy{ _mm_mul_ps(qx, y2) };
+        __m128 const xz{ _mm_mul_ps(qx, z2) };
+        __m128 const yz{ _mm_mul_ps(qy, z2) };
+        __m128 const wx{ _mm_mul_ps(qw, x2) };
+        __m128 const wy{ _mm_mul_ps(qw, y2) };
+        __m128 const wz{ _mm_mul_ps(qw, z2) };
+
+        // `m<column><row>` of four nodes
+        __m128 m00{ _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx) };
+        __m128 m01{ _mm_mul_ps(_mm_add_ps(xy, wz), sx) };
+        __m128 m02{ _mm_mul_ps(_mm_sub_ps(xz, wy), sx) };
+        __m128 m03{ zero };
+        __m128 m10{ _mm_mul_ps(_mm_sub_ps(xy, wz), sy) };
+        __m128 m11{ _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy) };
+        __m128 m12{ _mm_mul_ps(_mm_add_ps(yz, wx), sy) };
+        __m128 m13{ zero };
+        __m128 m20{ _mm_mul_ps(_mm_add_ps(xz, wy), sz) };
+        __m128 m21{ _mm_mul_ps(_mm_sub_ps(yz, wx), sz) };
+        __m128 m22{ _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz) };
+        __m128 m23{ zero };
+
+        // after transpose register `l` is the column of node `ids[k + l]`
+        _MM_TRANSPOSE4_PS(m00, m01, m02, m03);
+        _MM_TRANSPOSE4_PS(m10, m11, m12, m13);
+        _MM_TRANSPOSE4_PS(m20, m21, m22, m23);
+        _MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+        __m128 const columns[4][4]{ { m00, m10, m20, tx },
+                                    { m01, m11, m21, ty },
+                                    { m02, m12, m22, tz },
+                                    { m03, m13, m23, tw } };
+        for (std::size_t l{ 0 }; l < 4; ++l)
+        {
+            float* const out{ glm::value_ptr(locals[k + l]) };
+            for (std::size_t c{ 0 }; c < 4; ++c) _mm_storeu_ps(out + 4 * c, columns[l][c]);
+        }
+    }
+#endif
+    for (; k < ids.size(); ++k)
+    {
+        auto const i{ ids[k] };
+        locals[k] = compose(translations[i], rotations[i], scales[i]);
+    }
+}
+
+///! `parent * local` for affine `local`, bottom row of it is known, so it is skipped
+glm::mat4
+multiply_affine(glm::mat4 const& parent, glm::mat4 const& local)
+{
+#if defined(DG_TRANSFORM_SSE)
+    float const* const p{ glm::value_ptr(parent) };
+    __m128 const p0{ _mm_loadu_ps(p) };
+    __m128 const p1{ _mm_loadu_ps(p + 4) };
+    __m128 const p2{ _mm_loadu_ps(p + 8) };
+    __m128 const p3{ _mm_loadu_ps(p + 12) };
+
+    glm::mat4 res;
+    for (glm::length_t c{ 0 }; c < 4; ++c)
+    {
+        __m128 col{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(local[c][0])),
+                                          _mm_mul_ps(p1, _mm_set1_ps(local[c][1]))),
+                               _mm_mul_ps(p2, _mm_set1_ps(local[c][2]))) };
+        if (c == 3) col = _mm_add_ps(col, p3);
+        _mm_storeu_ps(glm::value_ptr(res) + 4 * c, col);
+    }
+
+    return res;
+#else
+    return parent * local;
+#endif
+}
+
+///! columns of cofactor matrix are cross products of the other two columns, negated when
+///! determinant is negative so mirrored nodes keep outward normals. No inverse or division
+void
+cofactors(std::span<glm::mat4 const> worlds, node_span ids, std::span<glm::mat3> normals)
+{
+#if defined(DG_TRANSFORM_SSE)
+    for (auto const i : ids)
+    {
+        float const* const m{ glm::value_ptr(worlds[i]) };
+        __m128 const c0{ _mm_loadu_ps(m) };
+        __m128 const c1{ _mm_loadu_ps(m + 4) };
+        __m128 const c2{ _mm_loadu_ps(m + 8) };
+
+        __m128 n0{ cross(c1, c2) };
+        __m128 n1{ cross(c2, c0) };
+        __m128 n2{ cross(c0, c1) };
+
+        // det = c0 . (c1 x c2), only its sign is needed
+        alignas(16) float d[4];
+        _mm_store_ps(d, _mm_mul_ps(c0, n0));
+        if (d[0] + d[1] + d[2] < 0.0f)
+        {
+            __m128 const sign{ _mm_set1_ps(-0.0f) };
+            n0 = _mm_xor_ps(n0, sign);
+            n1 = _mm_xor_ps(n1, sign);
+            n2 = _mm_xor_ps(n2, sign);
+        }
+
+        // columns are packed by 3 floats, the last one mustn't write past the matrix
+        float* const out{ glm::value_ptr(normals[i]) };
+        _mm_storeu_ps(out, n0);
+        _mm_storeu_ps(out + 3, n1);
+        _mm_storel_pi(reinterpret_cast<__m64*>(out + 6), n2);
+        _mm_store_ss(out + 8, _mm_movehl_ps(n2, n2));
+    }
+#else
+    for (auto const i : ids)
+    {
+        glm::vec3 const c0{ worlds[i][0] };
+        glm::vec3 const c1{ worlds[i][1] };
+        glm::vec3 const c2{ worlds[i][2] };
+
+        glm::vec3 const n0{ glm::cross(c1, c2) };
+        float const sign{ glm::dot(c0, n0) < 0.0f ? -1.0f : 1.0f };
+        normals[i] = glm::mat3{ n0 * sign, glm::cross(c2, c0) * sign, glm::cross(c0, c1) * sign };
+    }
+#endif
+}
+
+} // namespace
+
+transform_hierarchy::node_id
+transform_hierarchy::add(node_id parent, glm::vec3 const& translation, glm::quat const& rotation,
+                         glm::vec3 const& scale)
+{
+    assert(parent == no_parent || parent < parents.size());
+
+    auto const id{ static_cast<node_id>(parents.size()) };
+    parents.push_back(parent);
+    translations.push_back(translation);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    worlds.emplace_back(1.0f);
+    normals.emplace_back(1.0f);
+    dirty.push_back(0);
+    mark_dirty(id);
+
+    return id;
+}
+
+void
+transform_hierarchy::translation(node_id id, glm::vec3 const& t)
+{
+    translations[id] = t;
+    mark_dirty(id);
+}
+
+void
+transform_hierarchy::rotation(node_id id, glm::quat const& r)
+{
+    rotations[id] = r;
+    mark_dirty(id);
+}
+
+void
+transform_hierarchy::scale(node_id id, glm::vec3 const& s)
+{
+    scales[id] = s;
+    mark_dirty(id);
+}
+
+void
+transform_hierarchy::update()
+{
+    changed_nodes.clear();
+    if (first_dirty == no_parent) return;
+
+    auto const count{ static_cast<node_id>(parents.size()) };
+    for (node_id i{ first_dirty }; i < count; ++i)
+    {
+        node_id const p{ parents[i] };
+        // parent is before child, so its flag is already final
+        if (p != no_parent) dirty[i] |= dirty[p];
+        if (dirty[i]) changed_nodes.push_back(i);
+    }
+
+    // local matrices don't depend on each other, so they are composed in a batch. Children need
+    // final world of their parent, which comes earlier in topological order
+    locals.resize(changed_nodes.size());
+    compose(translations, rotations, scales, changed_nodes, locals);
+    for (std::size_t k{ 0 }; k < changed_nodes.size(); ++k)
+    {
+        node_id const i{ changed_nodes[k] };
+        node_id const p{ parents[i] };
+        worlds[i] = p == no_parent ? locals[k] : multiply_affine(worlds[p], locals[k]);
+    }
+    // separate batch over changed nodes only, static ones keep their normal matrices
+    cofactors(worlds, changed_nodes, normals);
+
+    for (node_id const i : changed_nodes) dirty[i] = 0;
+    first_dirty = no_parent;
+}
+
+glm::mat4 const&
+transform_hierarchy::world(node_id id) const
+{
+    return worlds[id];
+}
+
+glm::mat3 const&
+transform_hierarchy::normal(node_id id) const
+{
+    return normals[id];
+}
+
+transform_hierarchy::node_id
+transform_hierarchy::parent(node_id id) const
+{
+    return parents[id];
+}
+
+std::span<transform_hierarchy::node_id const>
+transform_hierarchy::changed() const
+{
+    return changed_nodes;
+}
+
+std::size_t
+transform_hierarchy::size() const
+{
+    return parents.size();
+}
+
+void
+transform_hierarchy::mark_dirty(node_id id)
+{
+    assert(id < parents.size());
+
+    dirty[id] = 1;
+    first_dirty = std::min(first_dirty, id);
+}
+
+} // namespace dg
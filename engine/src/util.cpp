@@ -1,6 +1,9 @@
+#include <engine/error.hpp>
 #include <engine/util.hpp>
 
+#include <SDL3/SDL_iostream.h>
 #include <SDL3/SDL_log.h>
+
 #include <cstdlib>
 
 namespace dg
@@ -20,4 +23,66 @@ unimplemented(char const* const msg)
     std::abort();
 }
 
+std::vector<std::byte>
+load_file(std::filesystem::path const& filename)
+{
+    SDL_IOStream* const io = SDL_IOFromFile(filename.string().c_str(), "rb");
+    if (nullptr == io)
+    {
+        LOG_DEBUG("error occured openning file: %s", SDL_GetError());
+        return {};
+    }
+
+    SDL_SeekIO(io, 0, SDL_IO_SEEK_END);
+    size_t const filesize{ static_cast<size_t>(SDL_TellIO(io)) };
+    SDL_SeekIO(io, 0, SDL_IO_SEEK_SET);
+
+    std::vector<std::byte> buf;
+    buf.resize(filesize);
+    if (0 == SDL_ReadIO(io, buf.data(), filesize))
+    {
+        LOG_DEBUG("error occurs reading SDL_IOStream: %s", SDL_GetError());
+    }
+
+    if (0 != SDL_CloseIO(io))
+    {
+        LOG_DEBUG("error occurs closing SDL_IOStream: %s", SDL_GetError());
+    }
+
+    return buf;
+}
+
+bool
+save_file(std::filesystem::path const& filename, std::span<std::byte const> data)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(filename.parent_path(), ec);
+    if (ec)
+    {
+        LOG_DEBUG("error occured creating directories: %s", ec.message().c_str());
+        return false;
+    }
+
+    SDL_IOStream* const io = SDL_IOFromFile(filename.string().c_str(), "wb");
+    if (nullptr == io)
+    {
+        LOG_DEBUG("error occured openning file: %s", SDL_GetError());
+        return false;
+    }
+
+    bool is_success{ SDL_WriteIO(io, data.data(), data.size()) == data.size() };
+    if (!is_success)
+    {
+        LOG_DEBUG("error occurs writing SDL_IOStream: %s", SDL_GetError());
+    }
+
+    if (0 != SDL_CloseIO(io))
+    {
+        LOG_DEBUG("error occurs closing SDL_IOStream: %s", SDL_GetError());
+        is_success = false;
+    }
+
+    return is_success;
+}
+
 } // namespace dg
@@ -1,5 +1,8 @@
 #include <engine/bind_guard.hpp>
+#include <engine/context.hpp>
+#include <engine/deletion_queue.hpp>
 #include <engine/error.hpp>
+#include <engine/gl_state.hpp>
 #include <engine/mesh.hpp>
 #include <engine/vertex_array.hpp>
 
@@ -20,7 +23,8 @@ vertex_array::error::error(char const* msg)
 {
 }
 
-vertex_array::vertex_array(context const& /*ctx*/)
+vertex_array::vertex_array(context& c)
+    : ctx(&c)
 {
     GL_CHECK(glGenVertexArrays(1, &handle));
     if (handle == 0)
@@ -30,8 +34,12 @@ vertex_array::vertex_array(context const& /*ctx*/)
 }
 
 vertex_array::vertex_array(vertex_array&& other)
-    : handle(other.handle)
+    : ctx(other.ctx)
+    , handle(other.handle)
+    , buffers(std::move(other.buffers))
 {
+    other.handle = 0;
+    other.buffers.clear();
 }
 
 vertex_array&
@@ -39,15 +47,27 @@ vertex_array::operator=(vertex_array other)
 {
     using std::swap;
 
+    swap(ctx, other.ctx);
     swap(handle, other.handle);
+    swap(buffers, other.buffers);
 
     return *this;
 }
 
-vertex_array::~vertex_array() { GL_CHECK(glDeleteVertexArrays(1, &handle)); }
+vertex_array::~vertex_array()
+{
+    if (!ctx) return;
+
+    auto& deletions = ctx->deletions();
+    deletions.push(deletion_queue::object_t::vertex_array, handle);
+    for (auto const b : buffers)
+    {
+        deletions.push(deletion_queue::object_t::buffer, b);
+    }
+}
 
 void
-vertex_array::load(location loc, data_t type, std::vector<vertex_type> const& vertices)
+vertex_array::load(location loc, data_t type, std::vector<vertex_type> const& vertices, uint32_t components)
 {
     {
         bind_guard _{ *this };
@@ -62,14 +82,16 @@ vertex_array::load(location loc, data_t type, std::vector<vertex_type> const& ve
 
         GLuint vbo{ 0 };
         GL_CHECK(glGenBuffers(1, &vbo));
-        GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vbo));
+        buffers.push_back(vbo);
+        ctx->state().bind_buffer(buffer::target_t::array, vbo);
 
         GL_CHECK(glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertex_type), vertices.data(), draw_type));
-        GL_CHECK(glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(vertex_type), nullptr));
+        GL_CHECK(glVertexAttribPointer(loc, static_cast<GLint>(components), GL_FLOAT, GL_FALSE,
+                                       components * sizeof(vertex_type), nullptr));
 
         GL_CHECK(glEnableVertexAttribArray(loc));
     }
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    ctx->state().bind_buffer(buffer::target_t::array, 0);
 }
 
 void
@@ -88,29 +110,24 @@ vertex_array::load_indices(data_t type, std::vector<index_type> const& indices)
 
         GLuint vbe{ 0 };
         GL_CHECK(glGenBuffers(1, &vbe));
-        // TODO: save previous element array buffer to restore it after
-        GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbe));
+        buffers.push_back(vbe);
+        // element array binding belongs to this vertex array, so there is nothing to restore
+        ctx->state().bind_buffer(buffer::target_t::element_array, vbe);
         GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(index_type),
                               indices.data(), draw_type));
     }
-    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
 }
 
-std::any
+vertex_array::bind_state_t
 vertex_array::bind()
 {
-    GLint cur{ 0 };
-    GL_CHECK(glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &cur));
-    GL_CHECK(glBindVertexArray(handle));
-
-    return static_cast<handle_t>(cur);
+    return ctx->state().bind_vertex_array(handle);
 }
 
 void
-vertex_array::unbind(std::any data)
+vertex_array::unbind(bind_state_t prev)
 {
-    GL_CHECK(glBindVertexArray(0));
-    GL_CHECK(glBindVertexArray(std::any_cast<handle_t>(data)));
+    ctx->state().bind_vertex_array(prev);
 }
 
 } // namespace dg
@@ -0,0 +1,121 @@
+#include <doctest/doctest.h>
+
+#include <engine/bind_guard.hpp>
+
+#include <any>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace
+{
+
+// mimics what GL objects do with shadow state, but without GL
+uint32_t current{ 0 };
+uint64_t binds{ 0 };
+
+uint32_t
+fake_bind(uint32_t handle)
+{
+    uint32_t const prev{ current };
+    current = handle;
+    ++binds;
+
+    return prev;
+}
+
+// guard as it used to be: virtual interface and type erased state
+struct legacy_bindable
+{
+    virtual ~legacy_bindable() = default;
+    virtual std::any bind() = 0;
+    virtual void unbind(std::any data) = 0;
+};
+
+struct legacy_bind_guard
+{
+    explicit legacy_bind_guard(legacy_bindable& o)
+        : obj{ o }
+        , data{ o.bind() }
+    {
+    }
+
+    ~legacy_bind_guard() { obj.unbind(data); }
+
+    legacy_bindable& obj;
+    std::any data;
+};
+
+struct legacy_object : public legacy_bindable
+{
+    std::any bind() override { return fake_bind(handle); }
+    void unbind(std::any data) override { fake_bind(std::any_cast<uint32_t>(data)); }
+
+    uint32_t handle{ 1 };
+};
+
+struct object
+{
+    using bind_state_t = uint32_t;
+    bind_state_t bind() { return fake_bind(handle); }
+    void unbind(bind_state_t prev) { fake_bind(prev); }
+
+    uint32_t handle{ 1 };
+};
+
+static_assert(dg::bindable<object>);
+static_assert(!dg::bindable<legacy_object>);
+
+template <class F>
+double
+ns_per_iteration(uint32_t iterations, F&& f)
+{
+    auto const start{ std::chrono::steady_clock::now() };
+    for (uint32_t i{ 0 }; i < iterations; ++i) f();
+    auto const end{ std::chrono::steady_clock::now() };
+    std::chrono::duration<double, std::nano> const elapsed{ end - start };
+
+    return elapsed.count() / iterations;
+}
+
+} // namespace
+
+TEST_CASE("bind_guard restores previous binding")
+{
+    object a;
+    object b;
+    b.handle = 2;
+    current = 0;
+
+    {
+        dg::bind_guard _{ a };
+        CHECK(current == 1);
+        {
+            dg::bind_guard _{ b };
+            CHECK(current == 2);
+        }
+        CHECK(current == 1);
+    }
+    CHECK(current == 0);
+}
+
+// timing only, skipped by default, run with `test --no-skip --test-case="bind_guard overhead"`
+TEST_CASE("bind_guard overhead" * doctest::skip())
+{
+    constexpr uint32_t iterations{ 1'000'000 };
+
+    // called through pointer, so compiler can't devirtualize it
+    std::unique_ptr<legacy_bindable> legacy{ std::make_unique<legacy_object>() };
+    object typed;
+
+    binds = 0;
+    double const legacy_ns{ ns_per_iteration(iterations, [&] { legacy_bind_guard _{ *legacy }; }) };
+    CHECK(binds == 2 * iterations);
+
+    binds = 0;
+    double const typed_ns{ ns_per_iteration(iterations, [&] { dg::bind_guard _{ typed }; }) };
+    CHECK(binds == 2 * iterations);
+
+    MESSAGE("virtual + std::any: " << legacy_ns << " ns per bind/unbind");
+    MESSAGE("typed bind_guard:   " << typed_ns << " ns per bind/unbind");
+}
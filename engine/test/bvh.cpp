@@ -0,0 +1,134 @@
+#include <doctest/doctest.h>
+
+#include <engine/bvh.hpp>
+#include <engine/frustum.hpp>
+#include <engine/mesh.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+namespace
+{
+
+std::vector<dg::aabb>
+grid_boxes(float offset)
+{
+    std::vector<dg::aabb> boxes;
+    for (int x{ 0 }; x < 20; ++x)
+    {
+        for (int y{ 0 }; y < 20; ++y)
+        {
+            for (int z{ 0 }; z < 5; ++z)
+            {
+                glm::vec3 const p{ static_cast<float>(x) * 2.0f + offset,
+                                   static_cast<float>(y) * 2.0f, static_cast<float>(z) * -3.0f };
+                boxes.push_back({ p, p + glm::vec3{ 0.5f + static_cast<float>((x + y + z) % 3) } });
+            }
+        }
+    }
+
+    return boxes;
+}
+
+std::vector<dg::bvh::primitive_id>
+sorted(std::vector<dg::bvh::primitive_id> ids)
+{
+    std::ranges::sort(ids);
+    return ids;
+}
+
+} // namespace
+
+TEST_CASE("bvh queries match brute force")
+{
+    auto boxes = grid_boxes(0.0f);
+    dg::bvh tree;
+    tree.build(boxes);
+    REQUIRE(tree.size() == boxes.size());
+    REQUIRE(tree.nodes().size() < 2 * boxes.size());
+
+    auto const check = [&]
+    {
+        dg::aabb const box{ { 5.0f, 5.0f, -4.0f }, { 12.0f, 9.0f, 0.0f } };
+        auto const f = dg::frustum::from_matrix(glm::ortho(3.0f, 20.0f, 0.0f, 15.0f, -1.0f, 5.0f));
+
+        std::vector<dg::bvh::primitive_id> expected_box;
+        std::vector<dg::bvh::primitive_id> expected_frustum;
+        for (std::size_t i{ 0 }; i < boxes.size(); ++i)
+        {
+            auto const id = static_cast<dg::bvh::primitive_id>(i);
+            if (boxes[i].overlaps(box)) expected_box.push_back(id);
+            if (f.intersects_aabb(boxes[i].min, boxes[i].max)) expected_frustum.push_back(id);
+        }
+
+        std::vector<dg::bvh::primitive_id> ids;
+        tree.query(box, ids);
+        CHECK(sorted(ids) == expected_box);
+        tree.query(f, ids);
+        CHECK(sorted(ids) == expected_frustum);
+
+        // boxes are hit test geometry themselves, so distance is where ray enters them
+        dg::ray const r{ .origin = { 7.2f, 7.3f, 10.0f }, .direction = { 0.0f, 0.0f, -1.0f } };
+        std::optional<dg::bvh::hit> expected_hit;
+        for (std::size_t i{ 0 }; i < boxes.size(); ++i)
+        {
+            auto const& b = boxes[i];
+            if (r.origin.x < b.min.x || r.origin.x > b.max.x || r.origin.y < b.min.y
+                || r.origin.y > b.max.y)
+            {
+                continue;
+            }
+            float const distance{ r.origin.z - b.max.z };
+            if (!expected_hit || distance < expected_hit->distance)
+            {
+                expected_hit = { static_cast<dg::bvh::primitive_id>(i), distance };
+            }
+        }
+        REQUIRE(expected_hit);
+
+        auto const hit = tree.raycast(r,
+                                      [&](dg::bvh::primitive_id id, float) -> std::optional<float>
+                                      {
+                                          auto const& b = boxes[id];
+                                          if (r.origin.x < b.min.x || r.origin.x > b.max.x
+                                              || r.origin.y < b.min.y || r.origin.y > b.max.y)
+                                          {
+                                              return std::nullopt;
+                                          }
+                                          return r.origin.z - b.max.z;
+                                      });
+        REQUIRE(hit);
+        CHECK(hit->primitive == expected_hit->primitive);
+        CHECK(hit->distance == expected_hit->distance);
+    };
+
+    check();
+
+    boxes = grid_boxes(1.5f);
+    tree.refit(boxes);
+    check();
+}
+
+TEST_CASE("mesh_bvh hits the closest triangle")
+{
+    // two parallel quads facing +z, at z = 0 and z = -2
+    dg::mesh m;
+    m.vertices = { -1, -1, 0,  1, -1, 0,  1, 1, 0,  -1, 1, 0,
+                   -1, -1, -2, 1, -1, -2, 1, 1, -2, -1, 1, -2 };
+    m.indices = { 4, 5, 6, 4, 6, 7, 0, 1, 2, 0, 2, 3 };
+
+    dg::mesh_bvh const tree{ m, 1 };
+    CHECK(tree.bounds().min == glm::vec3{ -1.0f, -1.0f, -2.0f });
+    CHECK(tree.bounds().max == glm::vec3{ 1.0f, 1.0f, 0.0f });
+
+    auto const hit = tree.raycast({ .origin = { 0.5f, -0.25f, 5.0f }, .direction = { 0, 0, -1 } });
+    REQUIRE(hit);
+    CHECK(hit->primitive == 2);
+    CHECK(hit->distance == doctest::Approx(5.0f));
+
+    CHECK(!tree.raycast({ .origin = { 0.5f, -0.25f, 5.0f }, .direction = { 0, 0, 1 } }));
+    CHECK(!tree.raycast({ .origin = { 3.0f, 0.0f, 5.0f }, .direction = { 0, 0, -1 } }));
+}
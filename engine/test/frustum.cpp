@@ -0,0 +1,43 @@
+#include <doctest/doctest.h>
+
+#include <engine/frustum.hpp>
+#include <engine/thread_pool.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdint>
+#include <vector>
+
+TEST_CASE("frustum::cull matches per sphere test")
+{
+    auto const f = dg::frustum::from_matrix(glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 1.0f, 50.0f));
+
+    // grid crossing every plane, count isn't a multiple of lanes
+    dg::sphere_bounds bounds;
+    std::vector<uint32_t> expected;
+    for (int x{ -30 }; x <= 30; x += 3)
+    {
+        for (int y{ -30 }; y <= 30; y += 3)
+        {
+            for (int z{ -60 }; z <= 10; z += 7)
+            {
+                glm::vec3 const center{ static_cast<float>(x), static_cast<float>(y),
+                                        static_cast<float>(z) };
+                float const radius{ static_cast<float>((x + y + z) & 3) };
+                auto const id = bounds.add(center, radius);
+                if (f.intersects_sphere(center, radius)) expected.push_back(id);
+            }
+        }
+    }
+    REQUIRE(bounds.size() % dg::sphere_bounds::lanes != 0);
+    REQUIRE(!expected.empty());
+
+    std::vector<uint32_t> visible;
+    f.cull(bounds, visible);
+    CHECK(visible == expected);
+
+    dg::thread_pool pool{ 3 };
+    std::vector<uint32_t> parallel_visible;
+    f.cull(pool, bounds, parallel_visible, 64);
+    CHECK(parallel_visible == expected);
+}
@@ -0,0 +1,106 @@
+#include <doctest/doctest.h>
+
+#include <engine/light_clusters.hpp>
+#include <engine/thread_pool.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+
+std::vector<dg::point_light>
+light_grid()
+{
+    std::vector<dg::point_light> lights;
+    for (int x{ -10 }; x < 10; ++x)
+    {
+        for (int y{ -5 }; y < 5; ++y)
+        {
+            for (int z{ 0 }; z < 15; ++z)
+            {
+                lights.push_back({ .position = { static_cast<float>(x) * 1.7f,
+                                                 static_cast<float>(y) * 1.3f,
+                                                 static_cast<float>(z) * -2.9f + 2.0f },
+                                   .radius = 0.3f + static_cast<float>((x + y + z + 30) % 4) });
+            }
+        }
+    }
+
+    return lights;
+}
+
+} // namespace
+
+TEST_CASE("cluster_grid bins lights like brute force")
+{
+    glm::mat4 const projection{ glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, 50.0f) };
+    glm::mat4 view{ 1.0f };
+    view[3] = { 0.3f, -0.2f, -1.0f, 1.0f };
+    auto const lights = light_grid();
+
+    dg::cluster_grid grid;
+    grid.update(projection);
+    CHECK(grid.near_plane() == doctest::Approx(0.5f));
+    CHECK(grid.far_plane() == doctest::Approx(50.0f));
+
+    dg::thread_pool pool{ 3 };
+    grid.bin(pool, view, lights);
+
+    auto const clusters = grid.clusters();
+    auto const indices = grid.light_indices();
+    REQUIRE(clusters.size() == dg::cluster_grid::count);
+
+    std::size_t total{ 0 };
+    for (uint32_t c{ 0 }; c < dg::cluster_grid::count; ++c)
+    {
+        auto const& box = grid.bounds(c);
+        std::vector<uint32_t> expected;
+        for (uint32_t i{ 0 }; i < lights.size(); ++i)
+        {
+            glm::vec3 const p{ view * glm::vec4{ lights[i].position, 1.0f } };
+            glm::vec3 const d{ glm::max(glm::max(box.min - p, p - box.max), glm::vec3{ 0.0f }) };
+            if (glm::dot(d, d) <= lights[i].radius * lights[i].radius) expected.push_back(i);
+        }
+
+        auto const range = indices.subspan(clusters[c].x, clusters[c].y);
+        std::vector<uint32_t> actual(range.begin(), range.end());
+        std::ranges::sort(actual);
+        CHECK(actual == expected);
+        total += expected.size();
+    }
+    CHECK(total == indices.size());
+    CHECK(total > 0);
+}
+
+TEST_CASE("cluster_grid froxel lookup matches shader formula")
+{
+    glm::mat4 const projection{ glm::perspective(glm::radians(70.0f), 4.0f / 3.0f, 0.1f, 100.0f) };
+    dg::cluster_grid grid;
+    grid.update(projection);
+
+    // tiny light at view space point must be listed by froxel `dg_cluster_lights` picks for it
+    glm::vec3 const points[]{ { 0.0f, 0.0f, -1.0f },
+                              { 1.0f, -0.5f, -7.0f },
+                              { -3.0f, 2.0f, -40.0f } };
+    for (auto const& p : points)
+    {
+        std::vector<dg::point_light> const lights{ { .position = p, .radius = 1e-3f } };
+        dg::thread_pool pool{ 2 };
+        grid.bin(pool, glm::mat4{ 1.0f }, lights);
+
+        glm::vec4 const clip{ projection * glm::vec4{ p, 1.0f } };
+        glm::vec2 const screen{ glm::vec2(clip) / clip.w * 0.5f + 0.5f };
+        glm::vec2 const scale_bias{ grid.slice_scale_bias() };
+        auto const x = static_cast<uint32_t>(screen.x * dg::cluster_grid::tiles_x);
+        auto const y = static_cast<uint32_t>(screen.y * dg::cluster_grid::tiles_y);
+        auto const z = static_cast<uint32_t>(std::log(-p.z) * scale_bias.x + scale_bias.y);
+
+        auto const cluster = grid.clusters()[dg::cluster_grid::index(x, y, z)];
+        REQUIRE(cluster.y == 1);
+        CHECK(grid.light_indices()[cluster.x] == 0);
+    }
+}
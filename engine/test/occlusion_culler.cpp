@@ -0,0 +1,81 @@
+#include <doctest/doctest.h>
+
+#include <engine/occlusion_culler.hpp>
+#include <engine/thread_pool.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+// quad at NDC z = 0 covering the middle of the screen
+std::vector<float> const wall{ -0.5f, -0.5f, 0.0f, 0.5f, -0.5f, 0.0f,
+                               0.5f,  0.5f,  0.0f, -0.5f, 0.5f, 0.0f };
+std::vector<uint32_t> const wall_indices{ 0, 1, 2, 0, 2, 3 };
+
+} // namespace
+
+TEST_CASE("occlusion_culler rejects only boxes hidden behind occluders")
+{
+    // identity matrices keep clip space equal to NDC
+    dg::occlusion_culler culler{ { 64, 32 } };
+    culler.begin(glm::mat4{ 1.0f });
+    culler.add_occluder(glm::mat4{ 1.0f }, wall, wall_indices);
+    culler.rasterize();
+
+    REQUIRE(culler.levels() == 7);
+    CHECK(culler.size(6) == glm::u32vec2{ 1, 1 });
+    auto const depth = culler.depth();
+    CHECK(depth[16 * 64 + 32] == doctest::Approx(0.5f));
+    CHECK(depth[0] == 1.0f);
+    // wall doesn't cover whole screen, so top level keeps far plane
+    CHECK(culler.depth(6)[0] == 1.0f);
+
+    std::vector<dg::aabb> const boxes{
+        { { -0.2f, -0.2f, 0.5f }, { 0.2f, 0.2f, 0.8f } },   // behind
+        { { -0.2f, -0.2f, -0.8f }, { 0.2f, 0.2f, -0.5f } }, // in front
+        { { 0.6f, -0.2f, 0.5f }, { 0.9f, 0.2f, 0.8f } },    // next to it
+        { { 0.3f, -0.2f, 0.5f }, { 0.7f, 0.2f, 0.8f } },    // sticking out
+        { { -0.4f, -0.4f, -0.1f }, { 0.4f, 0.4f, 0.1f } },  // through it
+        { { -0.1f, -0.1f, 0.9f }, { 0.1f, 0.1f, 0.95f } },  // small, far behind
+    };
+    CHECK(!culler.is_visible(boxes[0]));
+    CHECK(culler.is_visible(boxes[1]));
+    CHECK(culler.is_visible(boxes[2]));
+    CHECK(culler.is_visible(boxes[3]));
+    CHECK(culler.is_visible(boxes[4]));
+    CHECK(!culler.is_visible(boxes[5]));
+
+    dg::thread_pool pool{ 3 };
+    std::vector<uint32_t> ids{ 5, 4, 3, 2, 1, 0 };
+    culler.cull(pool, boxes, ids);
+    CHECK(ids == std::vector<uint32_t>{ 4, 3, 2, 1 });
+}
+
+TEST_CASE("occlusion_culler tiles rasterize the same in parallel")
+{
+    // rotated and tilted quad, so depth varies across tiles
+    glm::mat4 model{ 1.0f };
+    model[0] = { 0.8f, 0.5f, 0.3f, 0.0f };
+    model[1] = { -0.5f, 0.8f, 0.2f, 0.0f };
+
+    dg::occlusion_culler serial{ { 250, 70 } };
+    serial.begin(glm::mat4{ 1.0f });
+    serial.add_occluder(model, wall, wall_indices);
+    serial.rasterize();
+
+    dg::thread_pool pool{ 3 };
+    dg::occlusion_culler parallel{ { 250, 70 } };
+    parallel.begin(glm::mat4{ 1.0f });
+    parallel.add_occluder(model, wall, wall_indices);
+    parallel.rasterize(pool);
+
+    // width is padded to whole SIMD registers
+    CHECK(serial.size() == glm::u32vec2{ 252, 70 });
+    for (uint32_t level{ 0 }; level < serial.levels(); ++level)
+    {
+        CHECK(std::ranges::equal(serial.depth(level), parallel.depth(level)));
+    }
+    CHECK(std::ranges::count_if(serial.depth(), [](float d) { return d < 1.0f; }) > 0);
+}
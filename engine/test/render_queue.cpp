@@ -0,0 +1,48 @@
+#include <doctest/doctest.h>
+
+#include <engine/render_queue.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+TEST_CASE("render_queue radix_sort matches std::stable_sort")
+{
+    std::mt19937_64 rng{ 42 };
+    std::vector<uint64_t> keys(10'000);
+
+    SUBCASE("random keys") { std::ranges::generate(keys, rng); }
+
+    SUBCASE("few distinct fields")
+    {
+        // only pass and depth differ, so most radix passes are skipped
+        for (auto& k : keys)
+        {
+            k = dg::render_queue::sort_key{ .pass = static_cast<uint32_t>(rng() % 3),
+                                            .pipeline = 7,
+                                            .depth = static_cast<uint32_t>(rng() % 100) }
+                    .pack();
+        }
+    }
+
+    std::vector<uint32_t> order;
+    dg::render_queue::radix_sort(keys, order);
+
+    std::vector<uint32_t> expected(keys.size());
+    for (uint32_t i{ 0 }; i < expected.size(); ++i) expected[i] = i;
+    std::ranges::stable_sort(expected, {}, [&keys](uint32_t i) { return keys[i]; });
+
+    CHECK(order == expected);
+}
+
+TEST_CASE("render_queue sort_key orders fields by significance")
+{
+    using key = dg::render_queue::sort_key;
+
+    CHECK(key{ .pass = 0, .depth = 0xFF'FFFF }.pack() < key{ .pass = 1 }.pack());
+    CHECK(key{ .pipeline = 1, .material = 0xFFF }.pack() < key{ .pipeline = 2 }.pack());
+    CHECK(key{ .mesh = 1 }.pack() < key{ .material = 1 }.pack());
+    CHECK(dg::render_queue::quantize_depth(1.0f, 10.0f)
+          < dg::render_queue::quantize_depth(2.0f, 10.0f));
+}
@@ -0,0 +1,173 @@
+#include <doctest/doctest.h>
+
+#include <engine/texture_loader.hpp>
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using format_t = dg::texture::format_t;
+
+struct ktx_header
+{
+    uint32_t gl_internal_format{ GL_COMPRESSED_RGB8_ETC2 };
+    glm::u32vec2 size{ 8 };
+    uint32_t array_elements{ 0 };
+    uint32_t key_value_bytes{ 0 };
+};
+
+void
+put(std::vector<std::byte>& out, uint32_t v)
+{
+    auto const at = out.size();
+    out.resize(at + sizeof(v));
+    std::memcpy(out.data() + at, &v, sizeof(v));
+}
+
+std::vector<std::byte>
+bytes(std::size_t count, uint8_t value)
+{
+    return std::vector<std::byte>(count, static_cast<std::byte>(value));
+}
+
+std::vector<std::byte>
+ktx(ktx_header const& h, std::vector<std::vector<std::byte>> const& levels)
+{
+    std::array<uint8_t, 12> const identifier{ 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31,
+                                              0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+    std::vector<std::byte> out;
+    for (auto const b : identifier) out.push_back(static_cast<std::byte>(b));
+
+    put(out, 0x04030201);
+    put(out, 0); // gl_type, 0 for compressed
+    put(out, 1); // gl_type_size
+    put(out, 0); // gl_format, 0 for compressed
+    put(out, h.gl_internal_format);
+    put(out, GL_RGB);
+    put(out, h.size.x);
+    put(out, h.size.y);
+    put(out, 0); // depth
+    put(out, h.array_elements);
+    put(out, 1); // faces
+    put(out, static_cast<uint32_t>(levels.size()));
+    put(out, h.key_value_bytes);
+    out.resize(out.size() + h.key_value_bytes, std::byte{ 0x7f });
+
+    for (auto const& level : levels)
+    {
+        put(out, static_cast<uint32_t>(level.size()));
+        out.insert(out.end(), level.begin(), level.end());
+        out.resize((out.size() + 3) & ~std::size_t{ 3 });
+    }
+    return out;
+}
+
+///! binary PPM is the smallest format stb decodes, `rgb` holds `w * h` pixels
+std::vector<std::byte>
+ppm(uint32_t w, uint32_t h, std::vector<uint8_t> const& rgb)
+{
+    auto const header = "P6\n" + std::to_string(w) + " " + std::to_string(h) + "\n255\n";
+    std::vector<std::byte> out;
+    for (auto const c : header) out.push_back(static_cast<std::byte>(c));
+    for (auto const c : rgb) out.push_back(static_cast<std::byte>(c));
+    return out;
+}
+
+} // namespace
+
+TEST_CASE("texture::level_size rounds up to whole blocks")
+{
+    CHECK(dg::texture::level_size(format_t::rgba8, { 4, 2 }, 0) == 32);
+    CHECK(dg::texture::level_size(format_t::rgba8, { 4, 2 }, 1) == 8);
+    // never smaller than one texel
+    CHECK(dg::texture::level_size(format_t::rgba8, { 4, 2 }, 5) == 4);
+
+    CHECK(dg::texture::level_size(format_t::etc2_rgb8, { 5, 4 }, 0) == 2 * 8);
+    CHECK(dg::texture::level_size(format_t::etc2_rgb8, { 5, 4 }, 2) == 8);
+    CHECK(dg::texture::level_size(format_t::etc2_rgba8, { 8, 8 }, 0) == 4 * 16);
+    CHECK(dg::texture::level_size(format_t::astc_6x6, { 13, 6 }, 0) == 3 * 16);
+    CHECK(dg::texture::level_size(format_t::astc_8x8, { 8, 8 }, 3) == 16);
+}
+
+TEST_CASE("KTX mips are read as stored")
+{
+    std::vector<std::vector<std::byte>> const levels{ bytes(4 * 8, 1), bytes(8, 2), bytes(8, 3),
+                                                      bytes(8, 4) };
+    auto const data = ktx({ .key_value_bytes = 8 }, levels);
+
+    auto const img = dg::decode(dg::image_t::ktx, data);
+    REQUIRE(img);
+    CHECK(img->format == format_t::etc2_rgb8);
+    CHECK(img->size == glm::u32vec2{ 8, 8 });
+    CHECK(img->levels == levels);
+}
+
+TEST_CASE("KTX rejects what texture can't upload")
+{
+    std::vector<std::vector<std::byte>> const levels{ bytes(4 * 8, 1), bytes(8, 2) };
+
+    SUBCASE("bad identifier")
+    {
+        auto data = ktx({}, levels);
+        data[1] = std::byte{ 'X' };
+        CHECK_FALSE(dg::decode(dg::image_t::ktx, data));
+    }
+    SUBCASE("array texture")
+    {
+        CHECK_FALSE(dg::decode(dg::image_t::ktx, ktx({ .array_elements = 2 }, levels)));
+    }
+    SUBCASE("unsupported format")
+    {
+        CHECK_FALSE(dg::decode(dg::image_t::ktx, ktx({ .gl_internal_format = GL_RGB8 }, levels)));
+    }
+    SUBCASE("base level size doesn't match format")
+    {
+        CHECK_FALSE(dg::decode(dg::image_t::ktx, ktx({}, { bytes(4 * 8 - 4, 1) })));
+    }
+    SUBCASE("truncated keeps complete levels")
+    {
+        auto data = ktx({}, levels);
+        data.resize(data.size() - 4);
+        auto const img = dg::decode(dg::image_t::ktx, data);
+        REQUIRE(img);
+        CHECK(img->levels.size() == 1);
+    }
+}
+
+TEST_CASE("raster mips are box filtered down to 1x1")
+{
+    // 4x2, red is a gradient, green is constant, blue is set only in the last column
+    std::vector<uint8_t> const rgb{ 0,  10, 0, 10, 10, 0, 20, 10, 0, 30, 10, 100, //
+                                    40, 10, 0, 50, 10, 0, 60, 10, 0, 71, 10, 100 };
+
+    auto const img = dg::decode(dg::image_t::raster, ppm(4, 2, rgb));
+    REQUIRE(img);
+    CHECK(img->format == format_t::rgba8);
+    CHECK(img->size == glm::u32vec2{ 4, 2 });
+    REQUIRE(img->levels.size() == 3);
+    CHECK(img->levels[0].size() == 4 * 2 * 4);
+    CHECK(img->levels[0][7] == std::byte{ 255 });
+
+    auto const texel = [&](std::size_t level, std::size_t x, std::size_t c)
+    { return std::to_integer<int>(img->levels[level][x * 4 + c]); };
+
+    REQUIRE(img->levels[1].size() == 2 * 1 * 4);
+    CHECK(texel(1, 0, 0) == 25);
+    // (20 + 30 + 60 + 71 + 2) / 4 rounds to nearest
+    CHECK(texel(1, 1, 0) == 45);
+    CHECK(texel(1, 1, 1) == 10);
+    CHECK(texel(1, 1, 2) == 50);
+    CHECK(texel(1, 1, 3) == 255);
+
+    // 1 texel tall, the missing row repeats the edge
+    REQUIRE(img->levels[2].size() == 4);
+    CHECK(texel(2, 0, 0) == 35);
+    CHECK(texel(2, 0, 2) == 25);
+}
@@ -0,0 +1,40 @@
+#include <doctest/doctest.h>
+
+#include <engine/thread_pool.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("thread_pool::parallel_for visits every index once")
+{
+    dg::thread_pool pool{ 3 };
+
+    std::vector<std::atomic<int>> visits(1000);
+    pool.parallel_for(visits.size(), [&](std::size_t begin, std::size_t end)
+    {
+        for (auto i{ begin }; i < end; ++i) ++visits[i];
+    }, 7);
+
+    for (auto const& v : visits) CHECK(v == 1);
+}
+
+TEST_CASE("thread_pool::parallel_for rethrows after all chunks finish")
+{
+    dg::thread_pool pool{ 3 };
+
+    std::atomic<std::size_t> processed{ 0 };
+    auto const throwing = [&](std::size_t begin, std::size_t end)
+    {
+        processed += end - begin;
+        if (begin == 0) throw std::runtime_error{ "first chunk" };
+    };
+    CHECK_THROWS_AS(pool.parallel_for(100, throwing), std::runtime_error);
+    CHECK(processed == 100);
+
+    // pool stays usable
+    processed = 0;
+    pool.parallel_for(100, [&](std::size_t begin, std::size_t end) { processed += end - begin; });
+    CHECK(processed == 100);
+}
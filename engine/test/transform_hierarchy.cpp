@@ -0,0 +1,93 @@
+#include <doctest/doctest.h>
+
+#include <engine/transform_hierarchy.hpp>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+TEST_CASE("transform_hierarchy propagates only changed subtrees")
+{
+    dg::transform_hierarchy h;
+    auto const root = h.add(dg::transform_hierarchy::no_parent, { 1.0f, 0.0f, 0.0f });
+    auto const child = h.add(root, { 0.0f, 2.0f, 0.0f });
+    auto const other = h.add(dg::transform_hierarchy::no_parent, { 0.0f, 0.0f, 3.0f });
+
+    h.update();
+    CHECK(h.changed().size() == 3);
+    CHECK(h.world(child)[3] == glm::vec4{ 1.0f, 2.0f, 0.0f, 1.0f });
+    CHECK(h.world(other)[3] == glm::vec4{ 0.0f, 0.0f, 3.0f, 1.0f });
+
+    h.update();
+    CHECK(h.changed().empty());
+
+    h.translation(root, { 5.0f, 0.0f, 0.0f });
+    h.update();
+    CHECK(std::vector(h.changed().begin(), h.changed().end())
+          == std::vector<dg::transform_hierarchy::node_id>{ root, child });
+    CHECK(h.world(child)[3] == glm::vec4{ 5.0f, 2.0f, 0.0f, 1.0f });
+
+    h.scale(child, glm::vec3{ 2.0f });
+    h.update();
+    CHECK(std::vector(h.changed().begin(), h.changed().end())
+          == std::vector<dg::transform_hierarchy::node_id>{ child });
+    CHECK(h.world(child)[0] == glm::vec4{ 2.0f, 0.0f, 0.0f, 0.0f });
+}
+
+TEST_CASE("transform_hierarchy normal matrices are scaled inverse transpose")
+{
+    dg::transform_hierarchy h;
+    auto const scaled = h.add(dg::transform_hierarchy::no_parent, glm::vec3{ 0.0f },
+                              glm::quat{ 1.0f, 0.0f, 0.0f, 0.0f }, { 1.0f, 2.0f, 4.0f });
+    auto const mirrored = h.add(dg::transform_hierarchy::no_parent, glm::vec3{ 0.0f },
+                                glm::quat{ 1.0f, 0.0f, 0.0f, 0.0f }, { -1.0f, 1.0f, 1.0f });
+    h.update();
+
+    // inverse transpose is diag(1, 1/2, 1/4), cofactor is that times determinant 8
+    CHECK(h.normal(scaled)
+          == glm::mat3{ { 8.0f, 0.0f, 0.0f }, { 0.0f, 4.0f, 0.0f }, { 0.0f, 0.0f, 2.0f } });
+    // negative determinant mustn't flip normals
+    CHECK(h.normal(mirrored)
+          == glm::mat3{ { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } });
+}
+
+TEST_CASE("transform_hierarchy batched update matches matrix products")
+{
+    dg::transform_hierarchy h;
+    std::vector<glm::mat4> expected;
+    // chains and roots mixed, count isn't a multiple of batch width
+    for (uint32_t i{ 0 }; i < 11; ++i)
+    {
+        float const f{ static_cast<float>(i) };
+        glm::vec3 const t{ f, 1.0f - f, 0.5f * f };
+        glm::vec4 q{ 0.3f + f, -0.2f * f, 0.1f, 1.0f - 0.05f * f };
+        q /= std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+        glm::quat const r{ q.w, q.x, q.y, q.z };
+        glm::vec3 const s{ 1.0f + 0.1f * f, 2.0f, i % 3 == 0 ? -1.0f : 0.5f };
+        auto const parent = i % 4 == 0 ? dg::transform_hierarchy::no_parent : i - 1;
+
+        h.add(parent, t, r, s);
+        glm::mat4 local{ glm::mat4_cast(r) };
+        for (glm::length_t c{ 0 }; c < 3; ++c) local[c] *= s[c];
+        local[3] = glm::vec4{ t, 1.0f };
+        expected.push_back(parent == dg::transform_hierarchy::no_parent ? local
+                                                                       : expected[parent] * local);
+    }
+    h.update();
+
+    REQUIRE(h.changed().size() == expected.size());
+    for (uint32_t i{ 0 }; i < expected.size(); ++i)
+    {
+        for (glm::length_t c{ 0 }; c < 4; ++c)
+        {
+            for (glm::length_t r{ 0 }; r < 4; ++r)
+            {
+                CHECK(h.world(i)[c][r] == doctest::Approx(expected[i][c][r]).epsilon(1e-4));
+            }
+        }
+    }
+}
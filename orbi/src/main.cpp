@@ -1,18 +1,37 @@
-#include <engine/bind_guard.hpp>
+#include <engine/bvh.hpp>
+#include <engine/command_list.hpp>
 #include <engine/context.hpp>
+#include <engine/depth_only.hpp>
 #include <engine/error.hpp>
+#include <engine/frustum.hpp>
+#include <engine/g_buffer.hpp>
+#include <engine/geometry_buffer.hpp>
+#include <engine/gpu_scene.hpp>
+#include <engine/light_clusters.hpp>
 #include <engine/mesh.hpp>
 #include <engine/mesh_loader.hpp>
+#include <engine/object_picker.hpp>
+#include <engine/occlusion_culler.hpp>
+#include <engine/occlusion_queries.hpp>
+#include <engine/pipeline_state.hpp>
+#include <engine/render_queue.hpp>
+#include <engine/shader_library.hpp>
 #include <engine/shader_program.hpp>
+#include <engine/shadow_map.hpp>
+#include <engine/thread_pool.hpp>
+#include <engine/transform_hierarchy.hpp>
+#include <engine/uniform_block.hpp>
 #include <engine/vertex_array.hpp>
 
 #include <SDL3/SDL_events.h>
 #include <SDL3/SDL_keycode.h>
 #include <SDL3/SDL_log.h>
+#include <SDL3/SDL_mouse.h>
 #include <SDL3/SDL_time.h>
 
 #include <glm/common.hpp>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <glad/glad.h>
@@ -20,55 +39,81 @@
 #include "glm/matrix.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdlib>
 #include <filesystem>
 #include <iostream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
 #include <string_view>
+#include <vector>
 
+// both shaders are built with `LIT` define, 0 is used for light source itself
 constexpr std::string_view vertex_shader_src = R"(
 #version 320 es
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 in_normal;
 
-layout (location = 2) uniform mat4 projection;
-layout (location = 3) uniform mat4 view;
-layout (location = 4) uniform mat4 model;
+layout (std140, binding = 0) uniform frame
+{
+    mat4 projection;
+    mat4 view;
+    vec3 camera_position;
+    float ambient_strength;
+    vec3 light_position;
+    float specular_strength;
+    vec3 light_color;
+};
+
+uniform mat4 model;
+
+// depth pre-pass uses the same transform in another program, main pass tests equal depth
+invariant gl_Position;
 
+#if LIT
 out vec3 normal;
 out vec3 fragment_position;
+#endif
 
 void main()
 {
     vec4 pos = vec4(position, 1.0f);
     gl_Position = projection * view * model * pos;
+#if LIT
     fragment_position = vec3(model * pos);
     normal = in_normal;
+#endif
 }
 )";
 
-constexpr std::string_view fragment_shader_src = R"(
+// `light_clusters`, `shadow_map` and `g_buffer` declarations go in between, they need default
+// float precision
+constexpr std::string_view fragment_shader_header = R"(
 #version 320 es
 precision mediump float;
+)";
 
-in vec3 normal;
-in vec3 fragment_position;
-
-out vec4 color;
-
-layout (location = 5) uniform vec4 vertex_color;
-layout (location = 6) uniform vec3 light_color;
-layout (location = 7) uniform vec3 light_position;
-layout (location = 8) uniform float ambient_strength;
-layout (location = 9) uniform mat3 normal_mat;
-layout (location = 10) uniform vec3 camera_position;
-layout (location = 11) uniform float specular_strength;
-
-void main()
+// shared by forward pass and deferred lighting, so both paths shade the same
+constexpr std::string_view shading_src = R"(
+layout (std140, binding = 0) uniform frame
+{
+    mat4 projection;
+    mat4 view;
+    vec3 camera_position;
+    float ambient_strength;
+    vec3 light_position;
+    float specular_strength;
+    vec3 light_color;
+};
+
+vec3 shade(highp vec3 fragment_position, vec3 norm)
 {
     vec3 ambient = ambient_strength * light_color;
 
-    vec3 norm = normalize(normal_mat * normal);
     vec3 light_direction = normalize(light_position - fragment_position);
     float diff = max(dot(norm, light_direction), 0.0f);
     vec3 diffuse = diff * light_color;
@@ -78,39 +123,155 @@ void main()
     float spec = pow(max(dot(view_direction, reflect_direction), 0.0f), 32.0f);
     vec3 specular = specular_strength * spec * light_color;
 
-    color = vec4(ambient + diffuse + specular, 1.0f) * vertex_color;
+    float shadow = dg_shadow(fragment_position);
+    diffuse *= shadow;
+    specular *= shadow;
+
+#if CLUSTERED
+    // point lights of the froxel, diffuse only, fading out to their radius
+    highp float view_depth = -(view * vec4(fragment_position, 1.0f)).z;
+    highp uvec2 cluster = dg_cluster_lights(gl_FragCoord.xy, view_depth);
+    for (highp uint i = 0u; i < cluster.y; ++i)
+    {
+        dg_point_light l = dg_lights[dg_light_indices[cluster.x + i]];
+        highp vec3 to_light = l.position - fragment_position;
+        highp float d = length(to_light);
+        float falloff = clamp(1.0f - d * d / (l.radius * l.radius), 0.0f, 1.0f);
+        diffuse += max(dot(norm, to_light / max(d, 1e-4f)), 0.0f) * falloff * falloff * l.intensity
+                   * l.color;
+    }
+#endif
+
+    return ambient + diffuse + specular;
 }
 )";
 
-constexpr std::string_view light_source_vertex_shader_src = R"(
-#version 320 es
+// `DEFERRED` variants fill g-buffer, alpha of albedo tells lighting whether to shade the pixel
+constexpr std::string_view fragment_shader_src = R"(
+#if LIT
+in vec3 normal;
+in highp vec3 fragment_position;
+#endif
 
-layout (location = 0) in vec3 position;
+#if !DEFERRED
+out vec4 color;
+#endif
 
-layout (location = 2) uniform mat4 projection;
-layout (location = 3) uniform mat4 view;
-layout (location = 4) uniform mat4 model;
+uniform vec4 vertex_color;
+uniform mat3 normal_mat;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(position, 1.0f);
+#if DEFERRED && LIT
+    dg_gbuffer_store(vec4(vertex_color.rgb, 1.0f), normalize(normal_mat * normal));
+#elif DEFERRED
+    dg_gbuffer_store(vec4(vertex_color.rgb, 0.0f), vec3(0.0f, 0.0f, 1.0f));
+#elif LIT
+    color = vec4(shade(fragment_position, normalize(normal_mat * normal)), 1.0f) * vertex_color;
+#else
+    color = vertex_color;
+#endif
 }
 )";
 
-constexpr std::string_view light_source_fragment_shader_src = R"(
-#version 320 es
-precision mediump float;
+// deferred lighting, runs once per covered pixel whatever the overdraw of geometry pass was
+constexpr std::string_view lighting_fragment_shader_src = R"(
+uniform highp mat4 inv_view_proj;
 
 out vec4 color;
 
-layout (location = 5) uniform vec4 vertex_color;
+void main()
+{
+    highp ivec2 pixel = ivec2(gl_FragCoord.xy);
+    highp float depth = dg_gbuffer_depth(pixel);
+    if (depth == 1.0f) discard;
+
+    vec4 albedo = dg_gbuffer_albedo(pixel);
+    vec3 light = vec3(1.0f);
+    if (albedo.a > 0.5f)
+    {
+        light = shade(dg_gbuffer_position(pixel, inv_view_proj), dg_gbuffer_normal(pixel));
+    }
+    color = vec4(light * albedo.rgb, 1.0f);
+    // later passes, e.g. occlusion queries, test against window depth
+    gl_FragDepth = depth;
+}
+)";
+
+// instances of `gpu_scene`, paired with lit forward fragment shader. They are uniformly scaled,
+// so model matrix transforms normals too
+constexpr std::string_view instance_vertex_shader_src = R"(
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 in_normal;
+
+layout (std140, binding = 0) uniform frame
+{
+    mat4 projection;
+    mat4 view;
+    vec3 camera_position;
+    float ambient_strength;
+    vec3 light_position;
+    float specular_strength;
+    vec3 light_color;
+};
+
+out vec3 normal;
+out vec3 fragment_position;
 
 void main()
 {
-    color = vertex_color;
+    mat4 model = dg_instance_model();
+    vec4 world = model * vec4(position, 1.0f);
+    gl_Position = projection * view * world;
+    fragment_position = world.xyz;
+    normal = mat3(model) * in_normal;
 }
 )";
 
+// must match `frame` block declared in shaders
+struct frame_data
+{
+    glm::mat4 projection{ 1.0f };
+    glm::mat4 view{ 1.0f };
+    glm::vec3 camera_position{};
+    float ambient_strength{};
+    glm::vec3 light_position{};
+    float specular_strength{};
+    glm::vec3 light_color{};
+    float padding{};
+};
+DG_STD140_MEMBER(frame_data, projection);
+DG_STD140_MEMBER(frame_data, view);
+DG_STD140_MEMBER(frame_data, camera_position);
+DG_STD140_MEMBER(frame_data, ambient_strength);
+DG_STD140_MEMBER(frame_data, light_position);
+DG_STD140_MEMBER(frame_data, specular_strength);
+DG_STD140_MEMBER(frame_data, light_color);
+
+// center of bounding box and distance to the farthest vertex from it
+glm::vec4
+bounding_sphere(dg::mesh const& m)
+{
+    glm::vec3 min{ std::numeric_limits<float>::max() };
+    glm::vec3 max{ std::numeric_limits<float>::lowest() };
+    for (std::size_t i{ 0 }; i + 2 < m.vertices.size(); i += 3)
+    {
+        glm::vec3 const p{ m.vertices[i], m.vertices[i + 1], m.vertices[i + 2] };
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    glm::vec3 const center = m.vertices.empty() ? glm::vec3{ 0 } : (min + max) * 0.5f;
+    float radius{ 0 };
+    for (std::size_t i{ 0 }; i + 2 < m.vertices.size(); i += 3)
+    {
+        glm::vec3 const p{ m.vertices[i], m.vertices[i + 1], m.vertices[i + 2] };
+        radius = std::max(radius, glm::length(p - center));
+    }
+
+    return glm::vec4{ center, radius };
+}
+
 int
 main(int /*argc*/, char** argv)
 {
@@ -118,17 +279,85 @@ main(int /*argc*/, char** argv)
 
     glm::vec2 win_size{ 960, 590 };
     context ctx("window", win_size);
-    ctx.enable(context::capability::depth_test);
 
-    shader_program program(ctx);
-    program.attach_from_src(shader_program::shader_t::fragment, fragment_shader_src);
-    program.attach_from_src(shader_program::shader_t::vertex, vertex_shader_src);
-    assert(program.link());
+    // `L` turns on a grid of small point lights bobbing above the plane, shaded per froxel. It
+    // needs storage buffers in fragment shader, which GLES doesn't guarantee, so shading is
+    // built without them where they are missing
+    std::optional<light_clusters> clustered_lights;
+    try
+    {
+        clustered_lights.emplace(ctx);
+    } catch (light_clusters::error const& e)
+    {
+        SDL_Log("clustered point lights are unavailable: %s", e.what());
+    }
 
-    shader_program light_source_program(ctx);
-    light_source_program.attach_from_src(shader_program::shader_t::fragment, light_source_fragment_shader_src);
-    light_source_program.attach_from_src(shader_program::shader_t::vertex, light_source_vertex_shader_src);
-    assert(light_source_program.link());
+    shader_library shaders(ctx);
+    std::string const shading_declarations{
+        std::string{ fragment_shader_header }
+        + (clustered_lights
+               ? "#define CLUSTERED 1\n" + std::string{ light_clusters::glsl_declarations }
+               : "#define CLUSTERED 0\n")
+        + std::string{ shadow_map::glsl_declarations }
+    };
+    std::string const phong_fragment_src{
+        shading_declarations + "#if DEFERRED\n" + std::string{ g_buffer::glsl_output_declarations }
+        + "#endif\n" + std::string{ shading_src } + std::string{ fragment_shader_src }
+    };
+    auto const phong = shaders.add(vertex_shader_src, phong_fragment_src,
+                                   { { .name = "LIT" }, { .name = "DEFERRED" } });
+    auto const lit = shaders.key(phong, { 1, 0 });
+    auto const unlit = shaders.key(phong, { 0, 0 });
+    auto const gbuffer_lit = shaders.key(phong, { 1, 1 });
+    auto const gbuffer_unlit = shaders.key(phong, { 0, 1 });
+    shaders.precompile(phong, lit);
+    shaders.precompile(phong, unlit);
+    std::string const lighting_fragment_src{ shading_declarations
+                                             + std::string{ g_buffer::glsl_input_declarations }
+                                             + std::string{ shading_src }
+                                             + std::string{ lighting_fragment_shader_src } };
+    auto const lighting =
+        shaders.add(g_buffer::resolve_vertex_shader_src, lighting_fragment_src, {});
+    auto const lighting_key = shaders.key(lighting, {});
+    std::string const instance_vertex_src{ "#version 320 es\n"
+                                           + std::string{ gpu_scene::glsl_declarations }
+                                           + std::string{ instance_vertex_shader_src } };
+    auto const instanced = shaders.add(instance_vertex_src, phong_fragment_src,
+                                       { { .name = "LIT" }, { .name = "DEFERRED" } });
+    auto const instanced_lit = shaders.key(instanced, { 1, 0 });
+    // pre-pass keeps the shaded vertex shader, so its depth equals the one of the main pass
+    auto const depth_only =
+        shaders.add(vertex_shader_src, depth_only_fragment_shader_src, { { .name = "LIT" } });
+    auto const depth_only_unlit = shaders.key(depth_only, { 0 });
+    shaders.precompile(depth_only, depth_only_unlit);
+    // submitted now, so they are compiled while meshes are loading
+    shaders.pump(2);
+
+    // created once their programs are ready, depth test is on by default
+    std::optional<pipeline_state> lit_pipeline;
+    std::optional<pipeline_state> unlit_pipeline;
+    // `F` toggles depth pre-pass: opaque draws fill depth first, then are shaded where depth is
+    // equal, so overlapping geometry is shaded once
+    pipeline_state::depth_t const equal_depth{ .write = false,
+                                               .func = pipeline_state::compare_t::equal };
+    std::optional<pipeline_state> depth_only_pipeline;
+    std::optional<pipeline_state> lit_equal_pipeline;
+    std::optional<pipeline_state> unlit_equal_pipeline;
+    bool is_depth_prepass{ false };
+    // `G` switches to deferred shading: objects fill g-buffer and every covered pixel is lit once
+    // in a full screen pass, lights are looked up in the same froxels as in forward pass. Depth
+    // pre-pass is skipped then, geometry pass doesn't shade anything
+    std::optional<pipeline_state> gbuffer_lit_pipeline;
+    std::optional<pipeline_state> gbuffer_unlit_pipeline;
+    std::optional<pipeline_state> lighting_pipeline;
+    pipeline_state::depth_t const overwrite_depth{ .func = pipeline_state::compare_t::always };
+    g_buffer gbuffer(ctx, ctx.window_size());
+    bool is_deferred{ false };
+
+    render_queue queue(ctx);
+    thread_pool pool;
+
+    uniform_block<frame_data> frame(ctx, 0);
 
     using fspath = std::filesystem::path;
     fspath const resdir{ fspath(argv[0]).parent_path() / context::resources_path() };
@@ -165,6 +394,120 @@ main(int /*argc*/, char** argv)
     plane_vao.load(1, vertex_array::data_t::immutable, plane_mesh.value().normals);
     plane_vao.load_indices(vertex_array::data_t::immutable, plane_mesh.value().indices);
 
+    // static objects aren't touched after first update
+    transform_hierarchy transforms;
+    glm::quat const no_rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+    auto const root = transform_hierarchy::no_parent;
+    auto const torus_node = transforms.add(root, { 0.0f, -1.0f, 0.5f }, no_rotation, { 1, 2, 3 });
+    auto const suzanne_node = transforms.add();
+    auto const plane_node = transforms.add(root, { 0.0f, -3.0f, 0.0f }, no_rotation, glm::vec3{ 5 });
+    auto const light_source_node =
+        transforms.add(root, glm::vec3{ 0.0f }, no_rotation, glm::vec3{ 0.05f });
+
+    struct scene_object
+    {
+        vertex_array* vao{ nullptr };
+        uint32_t mesh_id{ 0 };
+        uint32_t index_count{ 0 };
+        transform_hierarchy::node_id node{ 0 };
+        ///! local bounding sphere
+        glm::vec4 bounds{ 0.0f };
+        uint32_t material_id{ 0 };
+        glm::vec4 color{ 1.0f };
+        bool is_lit{ true };
+        ///! rasterized into software depth buffer, should be big and have few triangles
+        bool is_occluder{ false };
+        ///! moves every frame, so it is drawn over cached shadow map instead of into it
+        bool is_dynamic{ false };
+    };
+
+    glm::vec4 const orange{ 1.0f, 0.5f, 0.31f, 1.0f };
+    glm::vec4 const white{ 1.0f, 1.0f, 1.0f, 1.0f };
+
+    std::vector<scene_object> objects{
+        { .vao = &torus_vao,
+          .mesh_id = 0,
+          .index_count = static_cast<uint32_t>(torus_mesh->indices.size()),
+          .node = torus_node,
+          .bounds = bounding_sphere(*torus_mesh),
+          .color = orange },
+        { .vao = &suzanne_vao,
+          .mesh_id = 1,
+          .index_count = static_cast<uint32_t>(suzanne_mesh->indices.size()),
+          .node = suzanne_node,
+          .bounds = bounding_sphere(*suzanne_mesh),
+          .color = orange,
+          .is_dynamic = true },
+        { .vao = &plane_vao,
+          .mesh_id = 2,
+          .index_count = static_cast<uint32_t>(plane_mesh->indices.size()),
+          .node = plane_node,
+          .bounds = bounding_sphere(*plane_mesh),
+          .material_id = 1,
+          .color = white,
+          .is_occluder = true },
+        { .vao = &cube_vao,
+          .mesh_id = 3,
+          .index_count = static_cast<uint32_t>(cube_mesh->indices.size()),
+          .node = light_source_node,
+          .bounds = bounding_sphere(*cube_mesh),
+          .material_id = 1,
+          .color = white,
+          .is_lit = false },
+    };
+
+    // sphere id is object index, spheres are moved only when their node changes
+    sphere_bounds object_bounds;
+    auto const no_sphere = ~sphere_bounds::sphere_id{ 0 };
+    std::vector<sphere_bounds::sphere_id> node_spheres(transforms.size(), no_sphere);
+    for (auto const& o : objects)
+    {
+        node_spheres[o.node] = object_bounds.add(glm::vec3{ o.bounds }, o.bounds.w);
+    }
+    std::vector<uint32_t> visible;
+
+    // picking: triangle trees per mesh, indexed by `mesh_id`, and tree over objects world boxes
+    std::array<mesh const*, 4> const meshes{ &*torus_mesh, &*suzanne_mesh, &*plane_mesh,
+                                             &*cube_mesh };
+    std::vector<mesh_bvh> const mesh_trees = mesh_bvh::build(pool, meshes);
+    std::vector<aabb> object_boxes(objects.size());
+    bvh scene;
+    auto const no_object = ~uint32_t{ 0 };
+    uint32_t selected{ no_object };
+    glm::vec4 const highlight{ 0.3f, 1.0f, 0.3f, 1.0f };
+    glm::mat4 view_proj{ 1.0f };
+    // `P` switches between BVH ray cast and GPU id buffer, GPU result comes a frame or more later
+    object_picker picker(ctx);
+    bool is_gpu_picking{ false };
+    std::optional<glm::vec2> gpu_pick_cursor;
+    std::vector<object_picker::item> pick_items;
+    // `O` cycles how objects hidden behind others are rejected after frustum culling: software
+    // depth buffer of occluders, GPU queries of boxes read a frame or more later, or not at all,
+    // which is the default
+    enum class occlusion_t
+    {
+        software,
+        queries,
+        none
+    };
+    occlusion_t occlusion_mode{ occlusion_t::none };
+    occlusion_culler occlusion;
+    occlusion_queries queries(ctx);
+    std::vector<uint32_t> query_candidates;
+
+    // distances along unnormalized direction don't change in object space
+    auto const object_hit = [&](ray const& r, bvh::primitive_id id,
+                                float max_distance) -> std::optional<float>
+    {
+        scene_object const& o = objects[id];
+        glm::mat4 const inv_model = glm::inverse(transforms.world(o.node));
+        ray const local{ .origin = glm::vec3(inv_model * glm::vec4{ r.origin, 1.0f }),
+                         .direction = glm::vec3(inv_model * glm::vec4{ r.direction, 0.0f }) };
+        auto const hit = mesh_trees[o.mesh_id].raycast(local, max_distance);
+
+        return hit ? std::optional{ hit->distance } : std::nullopt;
+    };
+
     struct camera
     {
         glm::vec3 position{};
@@ -206,6 +549,64 @@ main(int /*argc*/, char** argv)
     light light_source{ .color = { 1.0f, 1.0f, 1.0f }, .ambient_strength = 0.2f, .specular_strength = 0.9f };
     bool is_light_source_rotating_around{ true };
 
+    std::vector<point_light> point_lights;
+    std::vector<float> point_light_phases;
+    for (int x{ 0 }; x < 64; ++x)
+    {
+        for (int z{ 0 }; z < 32; ++z)
+        {
+            float const phase{ static_cast<float>((x * 7 + z * 13) % 32) / 32.0f };
+            point_lights.push_back(
+                { .position = { static_cast<float>(x) * 0.16f - 5.0f, -2.7f,
+                                static_cast<float>(z) * 0.32f - 5.0f },
+                  .radius = 0.5f,
+                  .color = { phase, 1.0f - phase, static_cast<float>(x % 2) },
+                  .intensity = 0.6f });
+            point_light_phases.push_back(phase * 6.28f);
+        }
+    }
+    bool is_point_lights{ false };
+
+    // `I` toggles a field of instances culled by compute shader and drawn indirectly, so CPU cost
+    // doesn't depend on their number. It needs storage buffers in vertex shader, which GLES
+    // doesn't guarantee, so it is left out where they are missing
+    geometry_buffer instance_geometry(ctx);
+    std::array<geometry_buffer::mesh_id, 3> const instance_meshes{
+        instance_geometry.add(*torus_mesh), instance_geometry.add(*suzanne_mesh),
+        instance_geometry.add(*cube_mesh)
+    };
+    instance_geometry.upload();
+    std::optional<gpu_scene> instances;
+    try
+    {
+        instances.emplace(ctx, instance_geometry);
+    } catch (gpu_scene::error const& e)
+    {
+        SDL_Log("gpu driven instances are unavailable: %s", e.what());
+    }
+    if (instances)
+    {
+        for (int x{ 0 }; x < 24; ++x)
+        {
+            for (int z{ 0 }; z < 24; ++z)
+            {
+                glm::vec3 const p{ static_cast<float>(x) * 0.8f - 9.2f, 3.5f,
+                                   static_cast<float>(z) * 0.8f - 9.2f };
+                glm::mat4 const model = glm::scale(glm::translate(glm::mat4{ 1.0f }, p),
+                                                   glm::vec3{ 0.15f });
+                instances->add(instance_meshes[static_cast<std::size_t>(x + z) % 3], model);
+            }
+        }
+    }
+    std::optional<pipeline_state> instance_pipeline;
+    bool is_gpu_instances{ false };
+
+    // lit objects cast shadows of the main light, static ones are cached until the light moves
+    // (stop it with `-`), `H` logs how many cube faces the cache served last frame
+    shadow_map shadows(ctx);
+    std::vector<shadow_map::caster> static_casters;
+    std::vector<shadow_map::caster> dynamic_casters;
+
     while (true)
     {
         SDL_Event ev;
@@ -263,6 +664,51 @@ main(int /*argc*/, char** argv)
                 case SDLK_MINUS:
                     is_light_source_rotating_around = !is_light_source_rotating_around;
                     break;
+                case SDLK_P:
+                    is_gpu_picking = !is_gpu_picking;
+                    SDL_Log("picking: %s", is_gpu_picking ? "gpu id buffer" : "bvh ray cast");
+                    break;
+                case SDLK_F:
+                    is_depth_prepass = !is_depth_prepass;
+                    SDL_Log("depth pre-pass: %s", is_depth_prepass ? "on" : "off");
+                    break;
+                case SDLK_I:
+                    is_gpu_instances = instances && !is_gpu_instances;
+                    SDL_Log("gpu driven instances: %s", is_gpu_instances ? "on" : "off");
+                    break;
+                case SDLK_G:
+                    is_deferred = !is_deferred;
+                    SDL_Log("shading: %s", is_deferred ? "deferred" : "forward");
+                    break;
+                case SDLK_L:
+                    is_point_lights = clustered_lights && !is_point_lights;
+                    SDL_Log("point lights: %s", is_point_lights ? "on" : "off");
+                    break;
+                case SDLK_H:
+                {
+                    auto const& stats = ctx.stats();
+                    SDL_Log("shadow cache: %llu hits, %llu misses",
+                            static_cast<unsigned long long>(stats.shadow_cache_hits),
+                            static_cast<unsigned long long>(stats.shadow_cache_misses));
+                    break;
+                }
+                case SDLK_O:
+                    switch (occlusion_mode)
+                    {
+                    case occlusion_t::software:
+                        occlusion_mode = occlusion_t::queries;
+                        SDL_Log("occlusion culling: gpu queries");
+                        break;
+                    case occlusion_t::queries:
+                        occlusion_mode = occlusion_t::none;
+                        SDL_Log("occlusion culling: off");
+                        break;
+                    case occlusion_t::none:
+                        occlusion_mode = occlusion_t::software;
+                        SDL_Log("occlusion culling: software");
+                        break;
+                    }
+                    break;
                 }
                 is_lshift = ev.key.mod & SDL_KMOD_LSHIFT;
                 bool const new_is_lctrl = ev.key.mod & SDL_KMOD_LCTRL;
@@ -301,6 +747,32 @@ main(int /*argc*/, char** argv)
                 break;
             }
 
+            case SDL_EVENT_MOUSE_BUTTON_DOWN:
+            {
+                if (!is_lctrl || ev.button.button != SDL_BUTTON_LEFT) break;
+                if (is_gpu_picking)
+                {
+                    gpu_pick_cursor = glm::vec2{ ev.button.x, ev.button.y };
+                    break;
+                }
+
+                // cursor ray from near to far plane of last frame's camera
+                glm::vec2 const size{ ctx.window_size() };
+                glm::vec2 const ndc{ 2.0f * ev.button.x / size.x - 1.0f,
+                                     1.0f - 2.0f * ev.button.y / size.y };
+                glm::mat4 const inv_view_proj = glm::inverse(view_proj);
+                glm::vec4 const near = inv_view_proj * glm::vec4{ ndc, -1.0f, 1.0f };
+                glm::vec4 const far = inv_view_proj * glm::vec4{ ndc, 1.0f, 1.0f };
+                ray const r{ .origin = glm::vec3(near) / near.w,
+                             .direction = glm::vec3(far) / far.w - glm::vec3(near) / near.w };
+
+                auto const hit = scene.raycast(r, [&](bvh::primitive_id id, float max_distance)
+                                               { return object_hit(r, id, max_distance); });
+                selected = hit ? hit->primitive : no_object;
+                SDL_Log("selected object: %d", hit ? static_cast<int>(hit->primitive) : -1);
+                break;
+            }
+
             case SDL_EVENT_MOUSE_MOTION:
             {
                 if (is_lctrl)
@@ -339,91 +811,233 @@ main(int /*argc*/, char** argv)
 
         ctx.clear_window({ 0.2, 0.5, 1, 1 });
 
-        glm::mat4 proj{ 1.0f };
-        glm::mat4 view{ 1.0f };
-        {
-            auto const size = ctx.window_size();
-            float const ratio = static_cast<float>(size.x) / static_cast<float>(size.y);
+        auto const size = ctx.window_size();
+        float const ratio = static_cast<float>(size.x) / static_cast<float>(size.y);
+        glm::mat4 const projection = glm::perspective(glm::radians(45.0f), ratio, 0.1f, 100.0f);
+        glm::mat4 const view = glm::lookAt(cam.position, cam.position + cam.direction, cam.up);
 
-            proj = glm::perspective(glm::radians(45.0f), ratio, 0.1f, 100.0f);
-            view = glm::lookAt(cam.position, cam.position + cam.direction, cam.up);
+        frame.update({ .projection = projection,
+                       .view = view,
+                       .camera_position = cam.position,
+                       .ambient_strength = light_source.ambient_strength,
+                       .light_position = light_source.position,
+                       .specular_strength = light_source.specular_strength,
+                       .light_color = light_source.color });
 
-            program.uniform(7, light_source.position);
+        for (std::size_t i{ 0 }; i < point_lights.size(); ++i)
+        {
+            float const phase{ point_light_phases[i] };
+            point_lights[i].position.y = -2.7f + 0.2f * std::sin(last_ticks + phase);
         }
-
+        if (clustered_lights)
         {
-            bind_guard _{ program };
-
-            program.uniform(2, proj);
-            program.uniform(3, view);
-            program.uniform(6, light_source.color);
-            program.uniform(8, light_source.ambient_strength);
-            program.uniform(10, cam.position);
-            program.uniform(11, light_source.specular_strength);
-
-            {
-                glm::mat4 model{ 1.0f };
-                model = glm::translate(model, glm::vec3{ 0, -1.0f, 0.5f });
-                model = glm::scale(model, glm::vec3{ 1, 2, 3 });
+            clustered_lights->update(pool, projection, view, size,
+                                     is_point_lights ? std::span{ point_lights }
+                                                     : std::span<point_light>{});
+        }
 
-                program.uniform(4, model);
-                program.uniform(5, glm::vec4{ 1.0f, 0.5f, 0.31f, 1.0f });
+        shaders.pump(1);
 
-                glm::mat3 normal_mat = glm::transpose(glm::inverse(model));
-                program.uniform(9, normal_mat);
+        // nothing is drawn with variant until it is ready
+        shader_program* const program = shaders.get(phong, lit);
+        if (program && !lit_pipeline)
+        {
+            lit_pipeline.emplace(ctx, pipeline_state::desc{ .program = program });
+            lit_equal_pipeline.emplace(
+                ctx, pipeline_state::desc{ .program = program, .depth = equal_depth });
+        }
+        shader_program* const light_source_program = shaders.get(phong, unlit);
+        if (light_source_program && !unlit_pipeline)
+        {
+            unlit_pipeline.emplace(ctx, pipeline_state::desc{ .program = light_source_program });
+            unlit_equal_pipeline.emplace(
+                ctx, pipeline_state::desc{ .program = light_source_program, .depth = equal_depth });
+        }
+        shader_program* const depth_only_program = shaders.get(depth_only, depth_only_unlit);
+        if (depth_only_program && !depth_only_pipeline)
+        {
+            depth_only_pipeline.emplace(ctx, pipeline_state::desc{ .program = depth_only_program });
+        }
+        // deferred variants are queued on first use only
+        shader_program* const gbuffer_program = is_deferred ? shaders.get(phong, gbuffer_lit)
+                                                            : nullptr;
+        if (gbuffer_program && !gbuffer_lit_pipeline)
+        {
+            gbuffer_lit_pipeline.emplace(ctx, pipeline_state::desc{ .program = gbuffer_program });
+        }
+        shader_program* const gbuffer_unlit_program =
+            is_deferred ? shaders.get(phong, gbuffer_unlit) : nullptr;
+        if (gbuffer_unlit_program && !gbuffer_unlit_pipeline)
+        {
+            gbuffer_unlit_pipeline.emplace(
+                ctx, pipeline_state::desc{ .program = gbuffer_unlit_program });
+        }
+        shader_program* const lighting_program = is_deferred ? shaders.get(lighting, lighting_key)
+                                                             : nullptr;
+        if (lighting_program && !lighting_pipeline)
+        {
+            lighting_pipeline.emplace(
+                ctx, pipeline_state::desc{ .program = lighting_program, .depth = overwrite_depth });
+        }
+        // both fall back to plain forward pass until their programs are ready
+        bool const is_deferred_ready{ is_deferred && gbuffer_lit_pipeline && gbuffer_unlit_pipeline
+                                      && lighting_pipeline };
+        bool const is_prepass_ready{ is_depth_prepass && !is_deferred_ready
+                                     && depth_only_pipeline };
+        queue.depth_prepass(is_prepass_ready ? &*depth_only_pipeline : nullptr);
+
+        transforms.translation(light_source_node, light_source.position);
+        transforms.translation(suzanne_node, { 0.0f, 0.3f * std::sin(last_ticks), 0.0f });
+        transforms.update();
+        for (auto const node : transforms.changed())
+        {
+            auto const id = node_spheres[node];
+            if (id == no_sphere) continue;
+
+            glm::mat4 const& model = transforms.world(node);
+            object_boxes[id] = mesh_trees[objects[id].mesh_id].bounds().transformed(model);
+            glm::vec4 const& local = objects[id].bounds;
+            float const scale{ std::max({ glm::length(glm::vec3(model[0])),
+                                          glm::length(glm::vec3(model[1])),
+                                          glm::length(glm::vec3(model[2])) }) };
+            object_bounds.set(id, glm::vec3(model * glm::vec4(glm::vec3(local), 1.0f)),
+                              local.w * scale);
+        }
 
-                bind_guard _{ torus_vao };
+        if (scene.size() == 0)
+        {
+            scene.build(object_boxes);
+        } else if (!transforms.changed().empty())
+        {
+            scene.refit(object_boxes);
+        }
 
-                GL_CHECK(glDrawElements(GL_TRIANGLES, torus_mesh->indices.size(), GL_UNSIGNED_INT, nullptr));
-            }
+        static_casters.clear();
+        dynamic_casters.clear();
+        for (std::size_t i{ 0 }; i < objects.size(); ++i)
+        {
+            scene_object const& o = objects[i];
+            if (!o.is_lit) continue;
+
+            auto& casters = o.is_dynamic ? dynamic_casters : static_casters;
+            casters.push_back({ .mesh = { .vao = o.vao,
+                                          .index_count = o.index_count,
+                                          .model = transforms.world(o.node) },
+                                .bounds = object_boxes[i] });
+        }
+        shadows.update(light_source.position, static_casters, dynamic_casters);
 
+        // only objects intersecting view frustum are recorded
+        view_proj = projection * view;
+        frustum::from_matrix(view_proj).cull(pool, object_bounds, visible);
+        if (occlusion_mode == occlusion_t::software)
+        {
+            occlusion.begin(view_proj);
+            for (auto const& o : objects)
             {
-                glm::mat4 model{ 1.0f };
-
-                program.uniform(4, model);
-                program.uniform(5, glm::vec4{ 1.0f, 0.5f, 0.31f, 1.0f });
-
-                glm::mat3 normal_mat = glm::transpose(glm::inverse(model));
-                program.uniform(9, normal_mat);
-
-                bind_guard _{ suzanne_vao };
+                if (!o.is_occluder) continue;
 
-                GL_CHECK(glDrawElements(GL_TRIANGLES, suzanne_mesh->indices.size(), GL_UNSIGNED_INT, nullptr));
+                mesh const& m = *meshes[o.mesh_id];
+                occlusion.add_occluder(transforms.world(o.node), m.vertices, m.indices);
             }
+            occlusion.rasterize(pool);
+            occlusion.cull(pool, object_boxes, visible);
+        } else if (occlusion_mode == occlusion_t::queries)
+        {
+            // hidden objects are queried too, so they show up once they are uncovered
+            queries.poll();
+            query_candidates = visible;
+            queries.cull(visible);
+        }
 
+        // matrices are built on workers, GL thread only replays sorted draws. Draws are sorted by
+        // pipeline, material and mesh, then front to back
+        auto& lit_variant = is_deferred_ready ? gbuffer_lit_pipeline
+                            : is_prepass_ready ? lit_equal_pipeline
+                                               : lit_pipeline;
+        auto& unlit_variant = is_deferred_ready ? gbuffer_unlit_pipeline
+                              : is_prepass_ready ? unlit_equal_pipeline
+                                                 : unlit_pipeline;
+        pipeline_state const* const lit_state = lit_variant ? &*lit_variant : nullptr;
+        pipeline_state const* const unlit_state = unlit_variant ? &*unlit_variant : nullptr;
+        auto const record = [&](command_list& list, std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i{ begin }; i < end; ++i)
             {
-                glm::mat4 model{ 1.0f };
-                model = glm::translate(model, glm::vec3{ 0.0f, -3.0f, 0.0f });
-                model = glm::scale(model, glm::vec3{ 5 });
-
-                program.uniform(4, model);
-                program.uniform(5, glm::vec4{ 1.0f, 1.0f, 1.0f, 1.0f });
+                scene_object const& o = objects[visible[i]];
+                pipeline_state const* const pipeline = o.is_lit ? lit_state : unlit_state;
+                if (!pipeline) continue;
+
+                glm::mat4 const& model = transforms.world(o.node);
+
+                float const distance{ glm::length(glm::vec3(model[3]) - cam.position) };
+                render_queue::sort_key const key{ .pipeline = o.is_lit ? 0u : 1u,
+                                                  .material = o.material_id,
+                                                  .mesh = o.mesh_id,
+                                                  .depth = render_queue::quantize_depth(distance,
+                                                                                        100.0f) };
+
+                list.push({ .key = key.pack(),
+                            .pipeline = pipeline,
+                            .vao = o.vao,
+                            .index_count = o.index_count,
+                            .model = model,
+                            .normal_mat = transforms.normal(o.node),
+                            .color = visible[i] == selected ? highlight : o.color });
+            }
+        };
+        queue.record(pool, visible.size(), record);
 
-                glm::mat3 normal_mat = glm::transpose(glm::inverse(model));
-                program.uniform(9, normal_mat);
+        if (is_deferred_ready)
+        {
+            gbuffer.resize(size);
+            gbuffer.begin();
+        }
+        queue.submit();
+        if (is_deferred_ready)
+        {
+            gbuffer.end();
+            lighting_program->uniform("inv_view_proj", glm::inverse(view_proj));
+            gbuffer.resolve(*lighting_pipeline);
+        }
 
-                bind_guard _{ plane_vao };
+        // drawn after deferred lighting too, its pass leaves scene depth in window
+        shader_program* const instance_program =
+            is_gpu_instances ? shaders.get(instanced, instanced_lit) : nullptr;
+        if (instance_program && !instance_pipeline)
+        {
+            instance_pipeline.emplace(ctx, pipeline_state::desc{ .program = instance_program });
+        }
+        if (instance_program)
+        {
+            instances->cull(view_proj);
+            instance_pipeline->apply();
+            instance_program->uniform("normal_mat", glm::mat3{ 1.0f });
+            instance_program->uniform("vertex_color", orange);
+            instances->draw(*instance_program);
+        }
+        if (occlusion_mode == occlusion_t::queries)
+        {
+            queries.issue(view_proj, object_boxes, query_candidates);
+        }
 
-                GL_CHECK(glDrawElements(GL_TRIANGLES, plane_mesh->indices.size(), GL_UNSIGNED_INT, nullptr));
+        if (gpu_pick_cursor)
+        {
+            pick_items.clear();
+            for (uint32_t const i : visible)
+            {
+                pick_items.push_back({ .mesh = { .vao = objects[i].vao,
+                                                 .index_count = objects[i].index_count,
+                                                 .model = transforms.world(objects[i].node) },
+                                       .id = i });
             }
+            picker.pick(view_proj, *gpu_pick_cursor, pick_items);
+            gpu_pick_cursor.reset();
         }
-
+        if (auto const id = picker.poll())
         {
-            bind_guard _1{ light_source_program };
-
-            light_source_program.uniform(2, proj);
-            light_source_program.uniform(3, view);
-
-            glm::mat4 model{ 1.0f };
-            model = glm::translate(model, light_source.position);
-            model = glm::scale(model, glm::vec3{ 0.05f });
-
-            light_source_program.uniform(4, model);
-            light_source_program.uniform(5, glm::vec4{ 1.0f, 1.0f, 1.0f, 1.0f });
-
-            bind_guard _2{ cube_vao };
-
-            GL_CHECK(glDrawElements(GL_TRIANGLES, cube_mesh->indices.size(), GL_UNSIGNED_INT, nullptr));
+            selected = *id == object_picker::no_object ? no_object : *id;
+            SDL_Log("selected object: %d", selected == no_object ? -1 : static_cast<int>(selected));
         }
 
         ctx.swap_window();